@@ -1,11 +1,24 @@
 #include "Agent.h"
 #include "Cell.h"
+#include "Model.h"
 
-Agent::Agent(Model* model_ptr, int id, const std::string& agent_type, Cell* associated_cell)
-    : model(model_ptr), unique_id(id), type(agent_type), cell(associated_cell) {
+Agent::Agent(Model* model_ptr, AgentColumns* agent_columns, size_t agent_slot)
+    : model(model_ptr), columns(agent_columns), slot(agent_slot) {
 }
 
-void Agent::setCell(Cell* c) { cell = c; }
-Cell* Agent::getCell() const { return cell; }
-long long int Agent::getID() const { return unique_id; }
-std::string Agent::getType() const { return type; }
+void Agent::setFlag(uint8_t flag, bool on) {
+    if (on) {
+        columns->flags[slot] |= flag;
+    }
+    else {
+        columns->flags[slot] &= static_cast<uint8_t>(~flag);
+    }
+}
+
+RandomStream Agent::randomStream(RandomPurpose purpose) const {
+    return model->agentStream(getID(), purpose);
+}
+
+void Agent::setCell(Cell* c) { columns->cellIndex[slot] = c ? c->getIndex() : -1; }
+Cell* Agent::getCell() const { return model->getCellByIndex(columns->cellIndex[slot]); }
+long long int Agent::getID() const { return columns->ids[slot]; }
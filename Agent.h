@@ -2,30 +2,54 @@
 #define AGENT_H
 
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include "AgentStore.h"
+#include "CounterRNG.h"
 
 class Model;
 class Cell;
 
+// Thin view over one slot of a species' AgentColumns. All per-agent state lives in the columns.
 class Agent {
 protected:
     Model* model;
-    long long int unique_id;
-    std::string type;
-    Cell* cell;
+    AgentColumns* columns;
+    size_t slot;
+
+    int& energy() { return columns->energy[slot]; }
+    int energy() const { return columns->energy[slot]; }
+    int& age() { return columns->age[slot]; }
+    int age() const { return columns->age[slot]; }
+    int& timer() { return columns->timer[slot]; }
+    int timer() const { return columns->timer[slot]; }
+    bool hasFlag(uint8_t flag) const { return (columns->flags[slot] & flag) != 0; }
+    void setFlag(uint8_t flag, bool on);
+    // State as other agents see it: the pre-act snapshot while the columns are frozen, live otherwise
+    int observedEnergy() const { return columns->frozen ? columns->frozenEnergy[slot] : columns->energy[slot]; }
+    bool observedFlag(uint8_t flag) const { return ((columns->frozen ? columns->frozenFlags[slot] : columns->flags[slot]) & flag) != 0; }
+    // This agent's stream for purpose in the current step
+    RandomStream randomStream(RandomPurpose purpose) const;
 
 public:
-    Agent(Model* model_ptr, int id, const std::string& agent_type, Cell* associated_cell);
+    Agent(Model* model_ptr, AgentColumns* agent_columns, size_t agent_slot);
     virtual void prepare() = 0;
     virtual void act() = 0;
     virtual ~Agent() = default;
 
-    // Virtual initialization function
-    virtual void initializeType() = 0;
-
     void setCell(Cell* cell);
     Cell* getCell() const;
+    // Stable external id, for display, logging and serialization
     long long int getID() const;
-    std::string getType() const;
+    AgentHandle getHandle() const { return columns->handles[slot]; }
+    // Type name, for display; compare getTypeId() instead
+    const std::string& getType() const { return columns->type; }
+    AgentTypeId getTypeId() const { return columns->typeId; }
+    // Read-only copy of an agent another process owns (see Model::placeAgent); never a target
+    bool isGhost() const { return slot >= columns->activeSize(); }
+    // This agent as species T, or null if it is another species
+    template <class T> T* as() { return getTypeId() == agentTypeId<T>() ? static_cast<T*>(this) : nullptr; }
+    template <class T> const T* as() const { return getTypeId() == agentTypeId<T>() ? static_cast<const T*>(this) : nullptr; }
 };
 
 #endif
@@ -0,0 +1,46 @@
+#include "AgentPropertyMap.h"
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+
+namespace {
+
+std::shared_mutex registryMutex;
+std::unordered_map<std::string, std::vector<std::pair<std::string, AgentPropertyMap::Getter>>> properties;
+
+}
+
+void AgentPropertyMap::registerProperty(const std::string& type, const std::string& name, Getter getter) {
+    std::unique_lock lock(registryMutex);
+    auto& list = properties[type];
+    for (auto& [existing, existingGetter] : list) {
+        if (existing == name) {
+            existingGetter = std::move(getter);
+            return;
+        }
+    }
+    list.emplace_back(name, std::move(getter));
+}
+
+std::vector<std::pair<std::string, AgentPropertyMap::Getter>> AgentPropertyMap::getProperties(const std::string& type) {
+    std::shared_lock lock(registryMutex);
+    auto it = properties.find(type);
+    return it != properties.end() ? it->second : std::vector<std::pair<std::string, Getter>>{};
+}
+
+std::string AgentPropertyMap::getValue(const std::string& type, const std::string& name, const Agent* agent) {
+    Getter getter;
+    {
+        std::shared_lock lock(registryMutex);
+        auto it = properties.find(type);
+        if (it == properties.end()) return {};
+        for (const auto& [existing, existingGetter] : it->second) {
+            if (existing == name) {
+                getter = existingGetter;
+                break;
+            }
+        }
+    }
+    // Called outside the lock so a getter may itself use the registry
+    return getter ? getter(agent) : std::string();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <functional>
+
+class Agent;
+
+// Process-wide table of named, printable properties per agent type, for inspectors and
+// exporters. Types fill it from initializeType(), which every Model runs for its own stores,
+// so models built concurrently register into it at the same time. All members are
+// thread-safe; registering a name a type already has replaces its getter.
+class AgentPropertyMap {
+public:
+    using Getter = std::function<std::string(const Agent*)>;
+
+    static void registerProperty(const std::string& type, const std::string& name, Getter getter);
+    // Snapshot of type's properties in registration order; empty for unknown types
+    static std::vector<std::pair<std::string, Getter>> getProperties(const std::string& type);
+    // One property of agent, or an empty string if type has no property called name
+    static std::string getValue(const std::string& type, const std::string& name, const Agent* agent);
+};
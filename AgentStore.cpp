@@ -0,0 +1,81 @@
+#include "AgentStore.h"
+#include <algorithm>
+
+void AgentColumns::reserve(size_t n) {
+    ids.reserve(n);
+    handles.reserve(n);
+    cellIndex.reserve(n);
+    energy.reserve(n);
+    age.reserve(n);
+    timer.reserve(n);
+    flags.reserve(n);
+    cellSlot.reserve(n);
+    frozenEnergy.reserve(n);
+    frozenFlags.reserve(n);
+}
+
+void AgentColumns::resize(size_t n) {
+    if (n > capacity()) {
+        reserve(n);
+        growths++;
+    }
+    peak = std::max(peak, n);
+    ids.resize(n);
+    handles.resize(n);
+    cellIndex.resize(n);
+    energy.resize(n);
+    age.resize(n);
+    timer.resize(n);
+    flags.resize(n);
+    cellSlot.resize(n);
+}
+
+size_t AgentColumns::push(const AgentRecord& record, AgentHandle handle) {
+    if (ids.size() == ids.capacity()) {
+        reserve(grownCapacity(ids.size() + 1));
+        growths++;
+    }
+    acquired++;
+    peak = std::max(peak, ids.size() + 1);
+    ids.push_back(record.id);
+    handles.push_back(handle);
+    cellIndex.push_back(record.cellIndex);
+    energy.push_back(record.energy);
+    age.push_back(record.age);
+    timer.push_back(record.timer);
+    flags.push_back(record.flags);
+    cellSlot.push_back(0);
+    return ids.size() - 1;
+}
+
+void AgentColumns::freeze() {
+    frozenEnergy.assign(energy.begin(), energy.end());
+    frozenFlags.assign(flags.begin(), flags.end());
+    frozen = true;
+}
+
+AgentHandle AgentColumns::swapRemove(size_t slot) {
+    size_t last = ids.size() - 1;
+    AgentHandle moved;
+    if (slot != last) {
+        ids[slot] = ids[last];
+        handles[slot] = handles[last];
+        cellIndex[slot] = cellIndex[last];
+        energy[slot] = energy[last];
+        age[slot] = age[last];
+        timer[slot] = timer[last];
+        flags[slot] = flags[last];
+        cellSlot[slot] = cellSlot[last];
+        moved = handles[slot];
+    }
+    ids.pop_back();
+    handles.pop_back();
+    cellIndex.pop_back();
+    energy.pop_back();
+    age.pop_back();
+    timer.pop_back();
+    flags.pop_back();
+    cellSlot.pop_back();
+    released++;
+    return moved;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include "AgentType.h"
+#include "SlotMap.h"
+#include "Profiler.h"
+
+class Agent;
+class Model;
+
+// How agents refer to each other inside a model: resolves in O(1) through the model's slot
+// map, and goes stale once the agent is removed. AgentRecord::id is the stable external id.
+using AgentHandle = SlotHandle;
+
+// State of an agent that has been queued for addition but not yet placed in a store.
+struct AgentRecord {
+    long long int id = -1;
+    int cellIndex = -1;
+    int energy = 0;
+    int age = 0;
+    int timer = 0;
+    uint8_t flags = 0;
+};
+
+// Columnar state for every agent of one species. Slot i of each column belongs to the same agent.
+struct AgentColumns {
+    std::string type;
+    AgentTypeId typeId = 0;
+    std::vector<long long int> ids;
+    std::vector<AgentHandle> handles;
+    std::vector<int> cellIndex;
+    std::vector<int> energy;
+    std::vector<int> age;
+    std::vector<int> timer;
+    std::vector<uint8_t> flags;
+    // Where the agent sits in its cell's list, so leaving a cell needs no search
+    std::vector<uint32_t> cellSlot;
+
+    // Copies of energy and flags taken before a parallel act phase. While frozen, agents
+    // read each other through these, so nobody reads a column another thread is writing.
+    std::vector<int> frozenEnergy;
+    std::vector<uint8_t> frozenFlags;
+    bool frozen = false;
+
+    // Trailing slots holding read-only copies of agents another process owns, in a
+    // distributed run. They can be looked up and observed but never step.
+    size_t ghosts = 0;
+
+    // Slot pool accounting. A slot freed by swapRemove is reused by the next push, so the
+    // columns only reallocate when the live count passes capacity, and then all at once.
+    size_t peak = 0;
+    unsigned long long growths = 0;
+    unsigned long long acquired = 0;
+    unsigned long long released = 0;
+
+    size_t size() const { return ids.size(); }
+    size_t activeSize() const { return ids.size() - ghosts; }
+    size_t capacity() const { return ids.capacity(); }
+    // Sizes every column, snapshots included, for at least n agents
+    void reserve(size_t n);
+    // Capacity the pool grows to when it must hold n agents: at least double, never below 64
+    size_t grownCapacity(size_t n) const { return std::max({ n, capacity() * 2, size_t(64) }); }
+    // Sets every column to n slots at once, for a caller that fills them in bulk
+    void resize(size_t n);
+    void freeze();
+    void thaw() { frozen = false; }
+    size_t push(const AgentRecord& record, AgentHandle handle);
+    // Moves the last agent into slot and shrinks the columns by one.
+    // Returns the handle of the agent that moved, or a null handle if slot was the last one.
+    AgentHandle swapRemove(size_t slot);
+};
+
+// Type-erased interface used by Model to walk and maintain the per-species stores.
+class AgentStoreBase {
+protected:
+    AgentColumns columns;
+    int interactionRange;
+
+public:
+    AgentStoreBase(const std::string& type, AgentTypeId typeId, int range) : interactionRange(range) {
+        columns.type = type;
+        columns.typeId = typeId;
+    }
+    virtual ~AgentStoreBase() = default;
+
+    // Runs prepare() then act() for every agent in slot order
+    virtual void stepAll() = 0;
+    // Separate phases over slots [begin, end), for the parallel scheduler
+    virtual void prepareRange(size_t begin, size_t end) = 0;
+    virtual void actRange(size_t begin, size_t end) = 0;
+    // Same over an explicit list of slots, for the domain-decomposed scheduler
+    virtual void prepareSlots(const std::vector<size_t>& slots) = 0;
+    virtual void actSlots(const std::vector<size_t>& slots) = 0;
+    virtual Agent* view(size_t slot) = 0;
+    virtual size_t add(const AgentRecord& record, AgentHandle handle) = 0;
+    virtual void reserve(size_t n) = 0;
+    virtual AgentHandle remove(size_t slot) = 0;
+    // Sizes the store to n slots whose columns the caller then fills directly, as a
+    // checkpoint restore does; nothing is linked into cells or the model's index
+    virtual void resize(size_t n) = 0;
+
+    // Makes room for incoming more agents with at most one reallocation, grown as push grows
+    void reserveFor(size_t incoming) {
+        size_t needed = columns.size() + incoming;
+        if (needed > columns.capacity()) {
+            reserve(columns.grownCapacity(needed));
+            columns.growths++;
+        }
+    }
+
+    AgentColumns& getColumns() { return columns; }
+    const AgentColumns& getColumns() const { return columns; }
+    size_t size() const { return columns.size(); }
+    // Agents that step: every slot except the trailing ghosts
+    size_t activeSize() const { return columns.activeSize(); }
+    const std::string& getType() const { return columns.type; }
+    AgentTypeId getTypeId() const { return columns.typeId; }
+    // Farthest distance, in cells, an agent of this species reads or writes from its own cell
+    int getInteractionRange() const { return interactionRange; }
+};
+
+// Store for one concrete species. views[i] is a thin Agent bound to slot i of the columns,
+// so the step loop is a linear walk with calls the compiler can resolve statically.
+template <class T>
+class AgentStore : public AgentStoreBase {
+private:
+    Model* model;
+    std::vector<T> views;
+
+public:
+    explicit AgentStore(Model* m) : AgentStoreBase(T::typeName, agentTypeId<T>(), T::interactionRange), model(m) {}
+
+    void stepAll() override {
+        PROFILE_ACTING(columns.typeId);
+        for (size_t i = 0; i < columns.activeSize(); ++i) {
+            views[i].prepare();
+            views[i].act();
+        }
+    }
+
+    void prepareRange(size_t begin, size_t end) override {
+        PROFILE_ACTING(columns.typeId);
+        for (size_t i = begin; i < end; ++i) {
+            views[i].prepare();
+        }
+    }
+
+    void actRange(size_t begin, size_t end) override {
+        PROFILE_ACTING(columns.typeId);
+        for (size_t i = begin; i < end; ++i) {
+            views[i].act();
+        }
+    }
+
+    void prepareSlots(const std::vector<size_t>& slots) override {
+        PROFILE_ACTING(columns.typeId);
+        for (size_t slot : slots) {
+            views[slot].prepare();
+        }
+    }
+
+    void actSlots(const std::vector<size_t>& slots) override {
+        PROFILE_ACTING(columns.typeId);
+        for (size_t slot : slots) {
+            views[slot].act();
+        }
+    }
+
+    Agent* view(size_t slot) override { return &views[slot]; }
+
+    T* get(size_t slot) { return &views[slot]; }
+
+    size_t add(const AgentRecord& record, AgentHandle handle) override {
+        size_t slot = columns.push(record, handle);
+        if (views.capacity() < columns.capacity()) {
+            views.reserve(columns.capacity());
+        }
+        views.emplace_back(model, &columns, slot);
+        return slot;
+    }
+
+    void reserve(size_t n) override {
+        columns.reserve(n);
+        views.reserve(columns.capacity());
+    }
+
+    AgentHandle remove(size_t slot) override {
+        // Views are positional, so only the columns move; the last view is dropped
+        views.pop_back();
+        return columns.swapRemove(slot);
+    }
+
+    void resize(size_t n) override {
+        columns.resize(n);
+        views.reserve(columns.capacity());
+        while (views.size() > n) {
+            views.pop_back();
+        }
+        while (views.size() < n) {
+            views.emplace_back(model, &columns, views.size());
+        }
+    }
+};
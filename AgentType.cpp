@@ -0,0 +1,39 @@
+#include "AgentType.h"
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+std::mutex registryMutex;
+std::array<std::string, AgentTypes::maxTypes> names;
+std::atomic<size_t> typeCount{ 0 };
+
+}
+
+AgentTypeId AgentTypes::intern(const std::string& name) {
+    std::scoped_lock lock(registryMutex);
+    size_t n = typeCount.load(std::memory_order_relaxed);
+    for (size_t id = 0; id < n; ++id) {
+        if (names[id] == name) {
+            return static_cast<AgentTypeId>(id);
+        }
+    }
+    if (n == maxTypes) {
+        throw std::length_error("too many agent types");
+    }
+    names[n] = name;
+    typeCount.store(n + 1, std::memory_order_release);
+    return static_cast<AgentTypeId>(n);
+}
+
+const std::string& AgentTypes::name(AgentTypeId id) {
+    // Entries below typeCount are never written again
+    static const std::string unknown = "Unknown";
+    return id < typeCount.load(std::memory_order_acquire) ? names[id] : unknown;
+}
+
+size_t AgentTypes::count() {
+    return typeCount.load(std::memory_order_acquire);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Small integer standing in for an agent type name in hot paths
+using AgentTypeId = uint8_t;
+
+// Process-wide table of agent type names. Ids are handed out in the order names are first
+// interned and are never reused; the names themselves are only needed for display.
+class AgentTypes {
+public:
+    static constexpr size_t maxTypes = 64;
+
+    // Id for name, adding it if it has not been seen. Thread-safe.
+    static AgentTypeId intern(const std::string& name);
+    static const std::string& name(AgentTypeId id);
+    static size_t count();
+};
+
+// Id of species T, interned on first use
+template <class T>
+AgentTypeId agentTypeId() {
+    static const AgentTypeId id = AgentTypes::intern(T::typeName);
+    return id;
+}
@@ -5,9 +5,17 @@
 #include <algorithm>
 #include <iostream>
 
-Bird::Bird(Model* model_ptr, int id, Cell* associated_cell, Gender g)
-    : Agent(model_ptr, id, "Bird", associated_cell),
-      energy(200), age(0), maxEnergy(300), reproductionThreshold(150), visionRange(3),  gender(g), isCallingForMate(false), timeSpentCalling(0) {
+Bird::Bird(Model* model_ptr, AgentColumns* columns, size_t slot)
+    : Agent(model_ptr, columns, slot) {
+}
+
+AgentRecord Bird::create(Cell* cell, Gender gender) {
+    // The id is assigned when the model registers the agent
+    AgentRecord record;
+    record.cellIndex = cell->getIndex();
+    record.energy = 200;
+    record.flags = (gender == Gender::Female) ? femaleFlag : 0;
+    return record;
 }
 
 void Bird::initializeType() {
@@ -16,12 +24,12 @@ void Bird::initializeType() {
 
 void Bird::prepare() {
     // Prepare for the next step
-    age++;
+    age()++;
 }
 
 void Bird::act() {
-    if (energy <= 0 || age > 200) {
-        model->queueAgentForRemoval(unique_id);
+    if (energy() <= 0 || age() > 200) {
+        model->queueAgentForRemoval(getHandle());
         return;
     }
 
@@ -34,11 +42,16 @@ void Bird::act() {
 
 
 bool Bird::hunt() {
-    energy -= 10; // Hunting costs energy
+    energy() -= 10; // Hunting costs energy
     Worm* worm = findPrey();
     if (worm) {
-        energy = std::min(maxEnergy, energy + 40);
-        model->queueAgentForRemoval(worm->getID());
+        if (IntentBuffer* intents = model->deferredIntents(worm->getCell()->getIndex())) {
+            // Several birds may find the same worm; the first claim is resolved after act
+            intents->prey(getHandle(), worm->getHandle(), 40, maxEnergy);
+            return true;
+        }
+        energy() = std::min(maxEnergy, energy() + 40);
+        model->queueAgentForRemoval(worm->getHandle());
         return true;
         
     }
@@ -48,10 +61,11 @@ bool Bird::hunt() {
 void Bird::move() {
     Cell* currentCell = getCell();
     if (currentCell) {
-        Cell* newCell = currentCell->getRandomNeighbor();
+        RandomStream rng = randomStream(RandomPurpose::Move);
+        Cell* newCell = currentCell->getRandomNeighbor(rng);
         if (newCell) {
-            model->moveAgent(unique_id, newCell);
-            energy -= 5; // Moving costs energy
+            model->moveAgent(getHandle(), newCell);
+            energy() -= 5; // Moving costs energy
         }
     }
 }
@@ -66,18 +80,18 @@ void Bird::moveTowards(Cell * target) {
         if (target->getX() < currentCell->getX()) {
             newCell = model->getCell(currentCell->getX() - 1, currentCell->getY());
         }
-        else if (target->getX() > cell->getX()) {
+        else if (target->getX() > currentCell->getX()) {
             newCell = model->getCell(currentCell->getX() + 1, currentCell->getY());
         }
-        else if (target->getY() < cell->getY()) {
+        else if (target->getY() < currentCell->getY()) {
             newCell = model->getCell(currentCell->getX(), currentCell->getY() - 1);
         }
-        else if (target->getY() > cell->getY()) {
+        else if (target->getY() > currentCell->getY()) {
             newCell = model->getCell(currentCell->getX(), currentCell->getY() + 1);
             
         }
         if (newCell) {
-            model->moveAgent(getID(), newCell);
+            model->moveAgent(getHandle(), newCell);
         }
     }
 }
@@ -86,19 +100,19 @@ bool Bird::reproduce() {
     // Returns true if progress towards finding a mate was successful
     Cell* currentCell = getCell();
     if (!currentCell) return false;
-    if (energy < reproductionThreshold) {
+    if (energy() < reproductionThreshold) {
         return false;
     }
-    if (gender == Gender::Female) {
-        if (timeSpentCalling > visionRange) {
+    if (getGender() == Gender::Female) {
+        if (timeSpentCalling() > visionRange) {
             // Will stop calling for mate after visionRange + 1 steps unless blind
-            isCallingForMate = false;
-            timeSpentCalling = 0;
+            setFlag(callingFlag, false);
+            timeSpentCalling() = 0;
             return false;
         }
         // Perform mating call
-        isCallingForMate = true;
-        timeSpentCalling++;
+        setFlag(callingFlag, true);
+        timeSpentCalling()++;
         
         return true;
     }
@@ -116,20 +130,14 @@ bool Bird::reproduce() {
     }
 
     // If mate is in current cell
-    if (currentCell == mateCell && mate->energy >= reproductionThreshold ) {
+    if (currentCell == mateCell && mate->observedEnergy() >= reproductionThreshold ) {
         // Both parents lose energy
-        energy -= 50;
-        mate->energy -= 50;
+        energy() -= 50;
+        model->transferEnergy(mate->getHandle(), -50);
 
         // Place offspring in current cell
-        std::unique_ptr<Bird> offspring;
-        if (model->getRNG()() % 2 < 1) {
-            offspring = std::make_unique<Bird>(model, model->getNextID(), currentCell, Gender::Male);
-        }
-        else {
-            offspring = std::make_unique<Bird>(model, model->getNextID(), currentCell, Gender::Female);
-        }
-        model->queueAgentForAddition(std::move(offspring));
+        Gender offspringGender = (randomStream(RandomPurpose::OffspringGender).below(2) < 1) ? Gender::Male : Gender::Female;
+        model->queueAgentForAddition<Bird>(Bird::create(currentCell, offspringGender));
         return true;
     }
     return false;
@@ -137,10 +145,10 @@ bool Bird::reproduce() {
 
 void Bird::ageAndDie() {
     // Chance of death increases with age
-    if (age > 10) {
-        std::uniform_int_distribution<int> dist(0, 10);
-        if (dist(model->getRNG()) < (age - 10)) {
-            model->queueAgentForRemoval(unique_id);
+    if (age() > 10) {
+        // Uniform in [0, 10]
+        if (static_cast<int>(randomStream(RandomPurpose::Death).below(11)) < (age() - 10)) {
+            model->queueAgentForRemoval(getHandle());
         }
     }
 }
@@ -150,49 +158,28 @@ Worm* Bird::findPrey() {
     Cell* currentCell = getCell();
     if (!currentCell) return nullptr;
 
-    const std::vector<long long int>& agentIds = currentCell->getAgentIds();
-    for (long long int agentId : agentIds) {
-        Agent* agent = model->getAgent(agentId);
-        if (agent && agent->getType() == "Worm") {
-            Worm* prey = dynamic_cast<Worm*>(agent);
-            if (prey && !prey->isBurrowed()) {
-                return prey;
-            }
-        }
-    }
-    return nullptr;
+    // A ghost worm is eaten, if at all, on the rank that owns it
+    return model->findFirstWithin<Worm>(*currentCell, 0, [](const Worm& worm) {
+        return !worm.isBurrowed() && !worm.isGhost();
+    });
 } 
 
 Bird* Bird::findMate() {
-    // Get all neighboring cells within visionRange
+    // Look for a mate within visionRange
     Cell* currentCell = getCell();
     if (!currentCell) return nullptr;
 
-    std::vector<Cell*> neighbors;
-    neighbors = cell->getNeighborsWithinDistance(visionRange);
-
-    for (Cell* neighbor : neighbors) {
-        for (long long int agentId : neighbor->getAgentIds()) {
-            Agent* agent = model->getAgent(agentId);
-            if (agent->getType() == "Bird") {
-                Bird* otherBird = dynamic_cast<Bird*>(agent);
-                if (otherBird &&
-                    otherBird != this &&
-                    otherBird->getGender() != this->getGender() &&
-                    otherBird->isMakingMatingCall()) {
-                    return otherBird;
-                }
-            }
-        }
-    }
-    return nullptr;
+    // Calling birds of the other gender, excluding this bird's own cell
+    return model->findFirstWithin<Bird>(*currentCell, visionRange, [this](const Bird& other) {
+        return &other != this && !other.isGhost() && other.getGender() != getGender() && other.isMakingMatingCall();
+    }, false);
 }
 
 bool Bird::isMakingMatingCall() const {
-    return isCallingForMate;
+    return observedFlag(callingFlag);
 }
 
 Bird::Gender Bird::getGender() const
 {
-    return gender;
+    return observedFlag(femaleFlag) ? Gender::Female : Gender::Male;
 }
@@ -3,25 +3,30 @@
 #include "Agent.h"
 #include "Worm.h"
 
-class Bird : public Agent {
+class Bird final : public Agent {
 public:
     enum class Gender { Male, Female };
 private:
-    int energy;
-    int age;
-    int maxEnergy;
-    int reproductionThreshold;
-    int visionRange;
-    Gender gender;
-    bool isCallingForMate = false;
-    int timeSpentCalling = 0;
+    static constexpr int maxEnergy = 300;
+    static constexpr int reproductionThreshold = 150;
+    static constexpr uint8_t femaleFlag = 1 << 0;
+    static constexpr uint8_t callingFlag = 1 << 1;
+
+    // Steps spent calling for a mate are kept in the timer column
+    int& timeSpentCalling() { return timer(); }
 
 public:
-    Bird(Model* model_ptr, int id, Cell* associated_cell, Gender gender);
+    static constexpr const char* typeName = "Bird";
+    static constexpr int visionRange = 3;
+    // Farthest cell a bird reads during act()
+    static constexpr int interactionRange = visionRange;
+
+    Bird(Model* model_ptr, AgentColumns* columns, size_t slot);
+    static AgentRecord create(Cell* cell, Gender gender);
+    static void initializeType();
 
     void prepare() override;
     void act() override;
-    void initializeType() override;
 
     bool hunt();
     void move();
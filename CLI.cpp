@@ -1,5 +1,9 @@
 #include "CLI.h"
+#include "Tree.h"
+#include "Trace.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
 
 CLI::CLI(Model* model) : model(model) {
     std::cout << "[CLI] CLI object created on thread: " << std::this_thread::get_id() << std::endl;
@@ -31,6 +35,7 @@ void CLI::stop() {
 }
 
 void CLI::processInput() {
+    Trace::setThreadName("CLI");
     std::cout << "[CLI] IO thread running with ID: " << std::this_thread::get_id() << std::endl;
     while (running) {
         std::string input;
@@ -48,6 +53,7 @@ void CLI::handleCommand(const std::string& command) {
     cmd = command.substr(0, end);
     rmd = (end == std::string::npos) ? "" : command.substr(end + 1);
     std::cout << "[CLI] Command Handled by Thread with ID: " << std::this_thread::get_id() << std::endl;
+    TRACE_SCOPE("command", "cli");
     if (cmd == "help") {
         displayHelp();
     }
@@ -84,6 +90,118 @@ void CLI::handleCommand(const std::string& command) {
     else if (cmd == "metrics") {
         model->collectMetrics();
     }
+    else if (cmd == "pools") {
+        model->printPoolStats();
+    }
+    else if (cmd == "trace") {
+#if NHAGW_TRACE
+        std::string action = rmd.substr(0, rmd.find(' '));
+        if (action == "on" || action == "off") {
+            Trace::enable(action == "on");
+            std::cout << "Tracing " << action << std::endl;
+        }
+        else if (action == "clear") {
+            Trace::clear();
+            std::cout << "Trace cleared" << std::endl;
+        }
+        else if (action == "dump") {
+            size_t space = rmd.find(' ');
+            std::string path = space == std::string::npos ? "nhagw_trace.json" : rmd.substr(space + 1);
+            std::ofstream out(path);
+            if (!out) {
+                std::cout << "Cannot write " << path << std::endl;
+                return;
+            }
+            Trace::writeJson(out);
+            std::cout << "Trace written to " << path << std::endl;
+        }
+        else {
+            std::cout << "Usage: trace on|off|clear|dump [PATH]" << std::endl;
+        }
+#else
+        std::cout << "Tracing is compiled out; rebuild with -DNHAGW_TRACE=1" << std::endl;
+#endif
+    }
+    else if (cmd == "checkpoint") {
+        // checkpoint [PATH] | checkpoint every N [PATH] | checkpoint off
+        std::istringstream args(rmd);
+        std::string first;
+        args >> first;
+        if (first == "off") {
+            model->setCheckpointSchedule(0, "");
+            std::cout << "Periodic checkpoints stopped" << std::endl;
+        }
+        else if (first == "every") {
+            int every = 0;
+            std::string path = "nhagw.ckpt";
+            if (!(args >> every) || every < 1) {
+                std::cout << "Usage: checkpoint [PATH] | checkpoint every N [PATH] | checkpoint off" << std::endl;
+                return;
+            }
+            args >> path;
+            model->setCheckpointSchedule(static_cast<unsigned>(every), path);
+            std::cout << "Checkpointing to " << path << " every " << every << " steps" << std::endl;
+        }
+        else {
+            std::string path = first.empty() ? "nhagw.ckpt" : first;
+            model->requestCheckpoint(path);
+            std::cout << "Checkpoint to " << path << " queued before the next step" << std::endl;
+        }
+    }
+    else if (cmd == "profile") {
+        if (rmd == "reset") {
+            model->resetProfile();
+            std::cout << "Profile reset" << std::endl;
+        }
+        else {
+            model->printProfile();
+        }
+    }
+    else if (cmd == "scheduler") {
+        Scheduler scheduler;
+        if (!parseScheduler(rmd, scheduler)) {
+            std::cout << "Usage: scheduler sequential|shuffled|parallel|domains" << std::endl;
+            return;
+        }
+        model->setScheduler(scheduler);
+        std::cout << "Scheduler set to " << rmd << std::endl;
+    }
+    else if (cmd == "domains") {
+        if (rmd.empty()) {
+            std::cout << "Subdomains: " << model->getDomainCount() << ", halo width: " << model->getHaloWidth()
+                << ", migrations last step: " << model->getLastMigrations() << std::endl;
+        }
+        else {
+            int rows = 0, cols = 0;
+            try {
+                size_t split = rmd.find(' ');
+                rows = std::stoi(rmd.substr(0, split));
+                cols = (split == std::string::npos) ? 0 : std::stoi(rmd.substr(split + 1));
+            } catch (...) {
+                rows = cols = 0;
+            }
+            if (rows < 1 || cols < 1) {
+                std::cout << "Usage: domains [ROWS COLS]" << std::endl;
+                return;
+            }
+            model->setDomainGrid(rows, cols);
+            std::cout << "Subdomain grid set to " << rows << " x " << cols << std::endl;
+        }
+    }
+    else if (cmd == "threads") {
+        if (rmd.empty()) {
+            std::cout << "Threads: " << model->getThreadCount() << std::endl;
+        }
+        else {
+            try {
+                int threads = std::stoi(rmd);
+                model->setThreadCount(threads > 0 ? threads : 1);
+                std::cout << "Threads will be set to " << (threads > 0 ? threads : 1) << " on the next step" << std::endl;
+            } catch (...) {
+                std::cout << "Usage: threads [N]" << std::endl;
+            }
+        }
+    }
     else if (cmd == "quit") {
         model->setRunning(false);
         running = false;
@@ -95,10 +213,11 @@ void CLI::handleCommand(const std::string& command) {
 
 void CLI::displayGrid() const {
     std::cout << "\nCurrent Grid State (Step: " << model->getStepCount() << "):\n";
+    AgentTypeId tree = agentTypeId<Tree>();
     for (int i = 0; i < model->getHeight(); ++i) {
         for (int j = 0; j < model->getWidth(); ++j) {
             const Cell* cell = model->getCell(i, j);
-            if (cell->hasType("Tree")) {
+            if (cell->hasType(tree)) {
                 std::cout << "T ";
             }
             else {
@@ -118,6 +237,14 @@ void CLI::displayHelp() const {
        << "  pause    - Pause continuous simulation\n"
        << "  speed X  - Set simulation speed to X (e.g., 0.5, 1, 2)\n"
        << "  display  - Show current grid state\n"
+       << "  pools    - Show agent slot pool occupancy, growth and queue commits\n"
+       << "  profile [reset] - Show step phase percentiles and per-species counters, or clear them\n"
+       << "  trace on|off|clear|dump [PATH] - Record a per-thread timeline; dump writes trace-event JSON\n"
+       << "  checkpoint [PATH] - Save the model before the next step (default nhagw.ckpt)\n"
+       << "  checkpoint every N [PATH] | checkpoint off - Save after every N-th step, or stop\n"
+       << "  threads [N] - Show or set the number of simulation threads\n"
+       << "  scheduler sequential|shuffled|parallel|domains - Choose how agents are stepped\n"
+       << "  domains [R C] - Show subdomain stats or set an R x C subdomain grid\n"
        << "  quit     - Exit the program\n"
        << std::endl;
 } 
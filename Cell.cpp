@@ -1,23 +1,78 @@
 #include "Cell.h"
+#include "Stencil.h"
 #include "Model.h"
 #include "Agent.h"
+#include "EnvironmentKernel.h"
 #include <random>
-#include <algorithm>
+
+void GridFields::resize(size_t cellCount) {
+    weather.assign(cellCount, weatherState::Sunny); // Initialize weather with a default state
+    water.assign(cellCount, 0);
+    soilSaturation.assign(cellCount, 10);           // Initialize soilSaturation with a default value
+    nutrients.assign(cellCount, 10);
+    agents.clear();
+    agents.resize(cellCount);
+    for (auto& count : weatherCounts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+    weatherCounts[weatherState::Sunny].store(static_cast<long long>(cellCount), std::memory_order_relaxed);
+    waterTotal.store(0, std::memory_order_relaxed);
+    nutrientTotal.store(10 * static_cast<long long>(cellCount), std::memory_order_relaxed);
+}
+
+void GridFields::mergeWeather(const WeatherTally& tally) {
+    for (int state = 0; state < weatherStateCount; ++state) {
+        if (tally[state] != 0) {
+            weatherCounts[state].fetch_add(tally[state], std::memory_order_relaxed);
+        }
+    }
+}
+
+void GridFields::countWeather(size_t begin, size_t end, int sign) {
+    WeatherTally tally{};
+    for (size_t i = begin; i < end; ++i) {
+        tally[weather[i]] += sign;
+    }
+    mergeWeather(tally);
+}
+
+void GridFields::mergeTotals(const FieldTally& tally) {
+    if (tally.water != 0) {
+        waterTotal.fetch_add(tally.water, std::memory_order_relaxed);
+    }
+    if (tally.nutrients != 0) {
+        nutrientTotal.fetch_add(tally.nutrients, std::memory_order_relaxed);
+    }
+}
+
+void GridFields::countTotals(size_t begin, size_t end, int sign) {
+    FieldTally tally;
+    for (size_t i = begin; i < end; ++i) {
+        tally.water += water[i];
+        tally.nutrients += nutrients[i];
+    }
+    tally.water *= sign;
+    tally.nutrients *= sign;
+    mergeTotals(tally);
+}
 
 Cell::Cell() 
-   : water(0), 
-     nutrients(10), 
-     x(-1), 
-     y(-1), 
-     model(nullptr), 
-     maxSoilSaturation(100), // Initialize maxSoilSaturation with a default value
-     soilSaturation(10),     // Initialize soilSaturation with a default value
-     weather(weatherState::Sunny) // Initialize weather with a default state
+   : model(nullptr), 
+     fields(nullptr), 
+     index(-1)
 {}
-void Cell::initialize(Model* m, int row, int col) {
+void Cell::initialize(Model* m, GridFields* f, int cellIndex) {
     model = m;
-    x = row;
-    y = col;
+    fields = f;
+    index = cellIndex;
+}
+
+int Cell::getX() const {
+    return index / model->getWidth();
+}
+
+int Cell::getY() const {
+    return index % model->getWidth();
 }
 
 std::vector<Cell*> Cell::getOrthogonalNeighbors() {
@@ -27,125 +82,123 @@ std::vector<Cell*> Cell::getOrthogonalNeighbors() {
 std::vector<Cell*> Cell::getNeighborsWithinDistance(int distance) {
     std::vector<Cell*> neighbors;
     neighbors.reserve(2 * distance * distance + 2 * distance);
-
-    for (int dx = -distance; dx <= distance; ++dx) {
-        int maxDy = distance - std::abs(dx);
-        for (int dy = -maxDy; dy <= maxDy; ++dy) {
-            if (dx == 0 && dy == 0) continue; // Skip the center cell (self)
-            int nx = x + dx;
-            int ny = y + dy;
-
-            if (model->isTorus()) {
-                nx = (nx + model->getHeight()) % model->getHeight();
-                ny = (ny + model->getWidth()) % model->getWidth();
-            }
-            else {
-                if (nx < 0 || nx >= model->getHeight() || ny < 0 || ny >= model->getWidth()) {
-                    continue;
-                }
-            }
-            Cell* neighbor = model->getCell(nx, ny);
-            if (neighbor) {
-                neighbors.push_back(neighbor);
-            }
-        }
-    }
+    model->forEachCellWithin(*this, distance, [&](Cell& neighbor) {
+        neighbors.push_back(&neighbor);
+        return true;
+    });
     return neighbors;
 }
 
-Cell* Cell::getRandomNeighbor() {
-    std::vector<Cell*> neighbors = getOrthogonalNeighbors();
-    if (!neighbors.empty()) {
-        std::uniform_int_distribution<int> dist(0, neighbors.size() - 1);
-        return neighbors[dist(model->getRNG())];
+Cell* Cell::getRandomNeighbor(RandomStream& rng) {
+    // Same pick as choosing from getOrthogonalNeighbors(), without building the list
+    int x = getX();
+    int y = getY();
+    if (model->isTorus()) {
+        const CellOffset& offset = Stencil::orthogonal[rng.below(4)];
+        return model->getCell(x + offset.dx, y + offset.dy);
+    }
+    uint32_t valid = 0;
+    for (const CellOffset& offset : Stencil::orthogonal) {
+        if (model->getCell(x + offset.dx, y + offset.dy)) valid++;
+    }
+    if (valid == 0) {
+        return nullptr;
+    }
+    uint32_t pick = rng.below(valid);
+    for (const CellOffset& offset : Stencil::orthogonal) {
+        if (Cell* neighbor = model->getCell(x + offset.dx, y + offset.dy)) {
+            if (pick-- == 0) return neighbor;
+        }
     }
     return nullptr;
 }
 
 void Cell::setWeather(weatherState w)
 {
-    weather = w;
+    WeatherTally tally{};
+    changeWeather(w, tally);
+    fields->mergeWeather(tally);
+}
+
+void Cell::changeWeather(weatherState w, WeatherTally& tally) {
+    uint8_t& current = fields->weather[index];
+    if (current != w) {
+        tally[current]--;
+        tally[w]++;
+        current = static_cast<uint8_t>(w);
+    }
 }
 
 weatherState Cell::getWeather() const
 {
-    return weather;
+    return static_cast<weatherState>(fields->weather[index]);
 }
 
 void Cell::updateEnvironment() {
     // Get the current climate from the model (assuming it's stored there)
     const Climate& climate = model->getClimate();
-    
-    // Get current weather effects
-    const WeatherEffects& effects = climate.effects.at(weather);
-    
-    // Update water level based on weather effects
-    water = std::max(0, water + effects.waterChange);
-    // Simulate evaporation
-    int evaporation = static_cast<int>(water * effects.evaporationRate);
-    water = std::max(0, water - evaporation);
-    // Update soil saturation based on water
-    if (water > 0) {
-        if (soilSaturation < maxSoilSaturation) {
-            soilSaturation = std::min(maxSoilSaturation, soilSaturation + 1);
-            water--;
-        }
-    }
-    
-    // Determine next weather state based on transition probabilities
-    std::uniform_real_distribution<double> dist(0.0, 1.0);
-    double random = dist(model->getRNG());
-    double cumulative = 0.0;
-    
-    const auto& transitions = climate.transitionMatrix.at(weather);
-    for (const auto& [nextState, probability] : transitions) {
-        cumulative += probability;
-        if (random <= cumulative) {
-            weather = nextState;
-            break;
-        }
-    }
+
+    // Water, evaporation and soil saturation from the precomputed effect tables
+    int before = fields->water[index];
+    updateWaterAndSoil(fields->water[index], fields->soilSaturation[index], fields->weather[index], climate, maxSoilSaturation);
+    fields->mergeTotals({ fields->water[index] - before, 0 });
+
+    updateWeather();
+}
+
+void Cell::updateWeather() {
+    WeatherTally tally{};
+    updateWeather(tally);
+    fields->mergeWeather(tally);
+}
+
+void Cell::updateWeather(WeatherTally& tally) {
+    // Determine next weather state from the climate's precompiled transition tables
+    // Each cell draws from its own stream, so the result does not depend on update order
+    RandomStream rng = model->cellStream(index, RandomPurpose::Weather);
+    changeWeather(model->getClimate().sampleNextWeather(getWeather(), rng.uniform()), tally);
 }
 
 int Cell::getWater() const {
-    return water; 
+    return fields->water[index]; 
 }
 void Cell::modifyWater(int w) {
+    if (IntentBuffer* intents = model->deferredIntents(index)) {
+        intents->modifyCell(Intent::Kind::ModifyWater, index, w);
+        return;
+    }
+    int& water = fields->water[index];
+    int before = water;
     water += w;
     if (water < 0) {
         water = 0;
     }
+    model->tallyFields({ water - before, 0 });
 }
 int Cell::getNutrients() const { 
-    return nutrients; 
+    return fields->nutrients[index]; 
 }
 
 void Cell::modifyNutrients(int n) {
+    if (IntentBuffer* intents = model->deferredIntents(index)) {
+        intents->modifyCell(Intent::Kind::ModifyNutrients, index, n);
+        return;
+    }
+    int& nutrients = fields->nutrients[index];
+    int before = nutrients;
     nutrients += n;
     if (nutrients < 0) {
         nutrients = 0;
     }
-}
-
-void Cell::addAgent(long long int agentId) {
-    agentIds.push_back(agentId);
-}
-
-void Cell::removeAgent(long long int agentId) {
-    agentIds.erase(std::remove(agentIds.begin(), agentIds.end(), agentId), agentIds.end());
-}
-
-bool Cell::hasType(std::string type) const {
-    for (auto agentId : agentIds) {
-        Agent* agent = model->getAgent(agentId);
-        if (agent && agent->getType() == type) {
-            return true;
-        }
-    }
-    return false;
+    model->tallyFields({ 0, nutrients - before });
 }
 
 void Cell::modifySoilSaturation(int s){
+    if (IntentBuffer* intents = model->deferredIntents(index)) {
+        intents->modifyCell(Intent::Kind::ModifySoilSaturation, index, s);
+        return;
+    }
+    int& soilSaturation = fields->soilSaturation[index];
     soilSaturation += s;
     if (soilSaturation < 0) {
         soilSaturation = 0;
@@ -1,56 +1,122 @@
 #pragma once
 
 #include <vector>
+#include <array>
+#include <atomic>
 #include <algorithm>
 #include <utility>
 #include <string>
+#include <cstdint>
 #include "Climate.h"
+#include "CounterRNG.h"
+#include "AgentType.h"
+#include "AgentStore.h"
+#include "CellAgents.h"
 
 class Agent;
 class Model;
 
-class Cell {
-private:
-    Model* model;
-    int x, y;
-    std::vector<long long int> agentIds;
+// Change in the number of cells per weatherState, gathered locally and merged in one go
+using WeatherTally = std::array<long long, weatherStateCount>;
+
+// Change in the grid's water and nutrient totals, gathered and merged the same way
+struct FieldTally {
+    long long water = 0;
+    long long nutrients = 0;
+};
+
+// Dense per-field storage for the whole grid, one entry per cell.
+// Cell i sits at row i / width, column i % width.
+struct GridFields {
     // Environment information
-    weatherState weather;
-    
+    std::vector<uint8_t> weather;
+
     // On top of soil information
-    int water;
+    std::vector<int> water;
 
     // Soil information
-    int soilSaturation;
-    int maxSoilSaturation;
-    int nutrients;
+    std::vector<int> soilSaturation;
+    std::vector<int> nutrients;
+
+    // Agents in each cell, grouped by type so each type's bucket is a contiguous run.
+    // Empty cells cost one pointer.
+    std::vector<CellAgentList> agents;
+
+    // Cells in each weatherState, kept current by every write to weather so metrics never scan
+    // the grid. Writers running in parallel tally locally and merge once.
+    std::array<std::atomic<long long>, weatherStateCount> weatherCounts{};
+    // Water and nutrients summed over all cells, kept current the same way
+    std::atomic<long long> waterTotal{ 0 };
+    std::atomic<long long> nutrientTotal{ 0 };
+
+    void resize(size_t cellCount);
+    void mergeWeather(const WeatherTally& tally);
+    // Takes cells [begin, end) out of weatherCounts (sign -1) or puts them back (+1), around
+    // bulk writes to weather such as a halo import
+    void countWeather(size_t begin, size_t end, int sign);
+    void mergeTotals(const FieldTally& tally);
+    // As countWeather, for the water and nutrient totals around bulk writes to those fields
+    void countTotals(size_t begin, size_t end, int sign);
+    HandleRange bucket(int cell, AgentTypeId type) const { return agents[cell].bucket(type); }
+};
+
+// View over one entry of the model's GridFields. Coordinates are derived from the index.
+class Cell {
+private:
+    Model* model;
+    GridFields* fields;
+    int index;
+
+    void changeWeather(weatherState w, WeatherTally& tally);
 
 public:
+    static constexpr int maxSoilSaturation = 100;
+
     Cell();
 
-    void initialize(Model* m, int row, int col);
+    void initialize(Model* m, GridFields* f, int cellIndex);
+    // Allocate their result; hot paths use Model::forEachCellWithin instead
     std::vector<Cell*> getOrthogonalNeighbors();
     std::vector<Cell*> getNeighborsWithinDistance(int distance);
-    Cell* getRandomNeighbor();
+    // Uniform over the orthogonal neighbours, one draw from rng, no allocation
+    Cell* getRandomNeighbor(RandomStream& rng);
 
     void setWeather(weatherState w);
     weatherState getWeather() const;
     void updateEnvironment();
+    // Samples the next weather state; the water/soil part is done by updateWaterAndSoilBatch
+    void updateWeather();
+    // Same, adding the transition to tally instead of the grid's counts, for callers that
+    // step many cells and merge once
+    void updateWeather(WeatherTally& tally);
     
     int getWater() const;
     void modifyWater(int w);
     int getNutrients() const;
     void modifyNutrients(int n);
 
-    void addAgent(long long int agentId);
-    void removeAgent(long long int agentId);
-    bool hasType(std::string type) const;
+    // Membership is kept O(types) both ways: the caller stores the returned position and hands
+    // it back on removal. Keeping the list grouped by type moves up to one other agent per
+    // type; moved(handle, position) reports each, so the caller can update what it stored.
+    // Order within a bucket is therefore not arrival order.
+    template <class Moved>
+    uint32_t addAgent(AgentHandle agent, AgentTypeId type, Moved&& moved) {
+        return fields->agents[index].insert(agent, type, moved);
+    }
+    template <class Moved>
+    void removeAgent(uint32_t position, AgentTypeId type, Moved&& moved) {
+        fields->agents[index].erase(position, type, moved);
+    }
+    bool hasType(AgentTypeId type) const { return countType(type) > 0; }
+    size_t countType(AgentTypeId type) const { return fields->bucket(index, type).size(); }
     
     // New methods for GUI
-    int getX() const { return x; }
-    int getY() const { return y; }
-    const std::vector<long long int>& getAgentIds() const { return agentIds; }
+    int getX() const;
+    int getY() const;
+    int getIndex() const { return index; }
+    HandleRange getAgents() const { return fields->agents[index].all(); }
+    HandleRange getAgents(AgentTypeId type) const { return fields->bucket(index, type); }
 
-    int getSoilSaturation() const { return soilSaturation; }
+    int getSoilSaturation() const { return fields->soilSaturation[index]; }
     void modifySoilSaturation(int s);
 };
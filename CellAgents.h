@@ -0,0 +1,166 @@
+#pragma once
+
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "AgentType.h"
+#include "SlotMap.h"
+
+// Contiguous run of handles inside a cell's list, such as one type's bucket
+struct HandleRange {
+    const SlotHandle* first = nullptr;
+    const SlotHandle* last = nullptr;
+
+    const SlotHandle* begin() const { return first; }
+    const SlotHandle* end() const { return last; }
+    size_t size() const { return static_cast<size_t>(last - first); }
+    bool empty() const { return first == last; }
+    const SlotHandle& operator[](size_t i) const { return first[i]; }
+};
+
+// The agents standing on one cell, grouped by type id: type t's bucket is the run of positions
+// [end(t - 1), end(t)). The run ends and the handles share one heap block, allocated on the
+// first arrival, so the grid pays a single pointer per cell however many types exist.
+//
+// insert() appends to the type's run and erase() fills the hole with the run's last entry.
+// To keep the runs contiguous, each later non-empty run also moves one entry (its first to its
+// end, or its last to its start); moved(handle, position) is called for every agent that moves
+// other than the one inserted, so callers can keep their back-indices current.
+class CellAgentList {
+private:
+    struct Header {
+        uint32_t size;
+        uint32_t capacity;
+        uint32_t types;  // run ends stored; runs of higher types are empty and sit at the end
+    };
+    Header* block = nullptr;
+
+    static size_t handleOffset(uint32_t types) {
+        size_t bytes = sizeof(Header) + sizeof(uint32_t) * types;
+        return (bytes + alignof(SlotHandle) - 1) / alignof(SlotHandle) * alignof(SlotHandle);
+    }
+    uint32_t* ends() const { return reinterpret_cast<uint32_t*>(block + 1); }
+    SlotHandle* data() const { return reinterpret_cast<SlotHandle*>(reinterpret_cast<char*>(block) + handleOffset(block->types)); }
+    uint32_t runEnd(AgentTypeId type) const { return type < block->types ? ends()[type] : block->size; }
+    uint32_t runBegin(AgentTypeId type) const { return type == 0 ? 0 : runEnd(type - 1); }
+
+    // Moves the list into a block with room for capacity handles and types run ends
+    void reallocate(uint32_t capacity, uint32_t types) {
+        uint32_t size = block ? block->size : 0;
+        Header* grown = static_cast<Header*>(std::malloc(handleOffset(types) + sizeof(SlotHandle) * capacity));
+        if (!grown) throw std::bad_alloc();
+        grown->size = size;
+        grown->capacity = capacity;
+        grown->types = types;
+        uint32_t* grownEnds = reinterpret_cast<uint32_t*>(grown + 1);
+        for (uint32_t t = 0; t < types; ++t) {
+            grownEnds[t] = block ? runEnd(t) : 0;
+        }
+        SlotHandle* grownData = reinterpret_cast<SlotHandle*>(reinterpret_cast<char*>(grown) + handleOffset(types));
+        if (block) {
+            std::memcpy(static_cast<void*>(grownData), data(), sizeof(SlotHandle) * size);
+            std::free(block);
+        }
+        block = grown;
+    }
+    void ensureRoom(uint32_t size, AgentTypeId type) {
+        uint32_t capacity = block ? block->capacity : 0;
+        uint32_t types = block ? block->types : 0;
+        if (size > capacity || type >= types) {
+            reallocate(size > capacity ? std::max({ size, capacity * 2, uint32_t(4) }) : capacity,
+                       std::max(types, static_cast<uint32_t>(type) + 1));
+        }
+    }
+
+public:
+    CellAgentList() = default;
+    ~CellAgentList() { std::free(block); }
+    CellAgentList(CellAgentList&& other) noexcept : block(other.block) { other.block = nullptr; }
+    CellAgentList& operator=(CellAgentList&& other) noexcept {
+        std::swap(block, other.block);
+        return *this;
+    }
+    CellAgentList(const CellAgentList&) = delete;
+    CellAgentList& operator=(const CellAgentList&) = delete;
+
+    size_t size() const { return block ? block->size : 0; }
+    HandleRange all() const {
+        if (!block) return {};
+        return { data(), data() + block->size };
+    }
+    HandleRange bucket(AgentTypeId type) const {
+        if (!block) return {};
+        return { data() + runBegin(type), data() + runEnd(type) };
+    }
+
+    // Adds agent at the end of type's run; returns its position
+    template <class Moved>
+    uint32_t insert(SlotHandle agent, AgentTypeId type, Moved&& moved) {
+        ensureRoom(static_cast<uint32_t>(size()) + 1, type);
+        SlotHandle* handles = data();
+        uint32_t* runEnds = ends();
+        uint32_t position = block->size++;
+        // Walk the free slot down from the end to type's run, one entry per later run
+        for (uint32_t t = block->types - 1; t > type; --t) {
+            uint32_t start = runEnds[t - 1];
+            if (start != position) {
+                handles[position] = handles[start];
+                moved(handles[position], position);
+            }
+            runEnds[t]++;
+            position = start;
+        }
+        handles[position] = agent;
+        runEnds[type]++;
+        return position;
+    }
+
+    // Takes out the agent of the given type at position
+    template <class Moved>
+    void erase(uint32_t position, AgentTypeId type, Moved&& moved) {
+        SlotHandle* handles = data();
+        uint32_t* runEnds = ends();
+        // Walk the hole up from position to the end of the list, one entry per later run
+        uint32_t hole = position;
+        for (uint32_t t = type; t < block->types; ++t) {
+            uint32_t last = runEnds[t] - 1;
+            if (last != hole) {
+                handles[hole] = handles[last];
+                moved(handles[hole], hole);
+                hole = last;
+            }
+            runEnds[t]--;
+        }
+        block->size--;
+    }
+
+    // Bulk rebuild, as a checkpoint restore does: place() every agent at its saved position,
+    // then seal(). place() returns false if position is already taken.
+    bool place(uint32_t position, SlotHandle agent, AgentTypeId type) {
+        uint32_t oldSize = static_cast<uint32_t>(size());
+        ensureRoom(std::max(oldSize, position + 1), type);
+        SlotHandle* handles = data();
+        for (uint32_t i = oldSize; i < position + 1; ++i) {
+            handles[i] = SlotHandle{};
+        }
+        block->size = std::max(oldSize, position + 1);
+        if (!handles[position].isNull()) return false;
+        handles[position] = agent;
+        ends()[type] = std::max(ends()[type], position + 1);
+        return true;
+    }
+    // Derives the run ends from what was placed. False if a position was left empty.
+    bool seal() {
+        if (!block) return true;
+        uint32_t* runEnds = ends();
+        for (uint32_t t = 1; t < block->types; ++t) {
+            runEnds[t] = std::max(runEnds[t], runEnds[t - 1]);
+        }
+        HandleRange everything = all();
+        return runEnds[block->types - 1] == block->size
+            && std::none_of(everything.begin(), everything.end(), [](const SlotHandle& h) { return h.isNull(); });
+    }
+};
@@ -0,0 +1,435 @@
+#include "Checkpoint.h"
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Model.h"
+#include "Tree.h"
+#include "Worm.h"
+#include "Bird.h"
+#include "Trace.h"
+
+namespace {
+
+static_assert(sizeof(int) == 4 && sizeof(long long int) == 8, "checkpoint columns assume 32-bit int and 64-bit long long");
+static_assert(sizeof(AgentHandle) == 8, "checkpoint handles are two uint32 words");
+
+constexpr char magic[8] = { 'N', 'H', 'A', 'G', 'W', 'C', 'K', 'P' };
+constexpr uint32_t byteOrderMark = 0x01020304;
+constexpr uint64_t sectionAlignment = 64;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t height;
+    int32_t width;
+    uint32_t seed;
+    uint32_t torus;
+    uint64_t stepCount;
+    int64_t counter;
+    uint64_t sectionCount;
+};
+
+struct SectionEntry {
+    char name[48];
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct StoreEntry {
+    char type[56];
+    uint64_t count;
+};
+
+// Species a checkpoint can hold, by type name
+using RegisterSpecies = AgentTypeId (Model::*)();
+const std::pair<const char*, RegisterSpecies> knownSpecies[] = {
+    { Tree::typeName, &Model::registerAgentType<Tree> },
+    { Worm::typeName, &Model::registerAgentType<Worm> },
+    { Bird::typeName, &Model::registerAgentType<Bird> },
+};
+
+uint64_t alignUp(uint64_t offset) {
+    return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+}
+
+template <size_t N>
+void copyName(char (&target)[N], const std::string& name) {
+    if (name.size() >= N) {
+        throw std::runtime_error("Checkpoint name too long: " + name);
+    }
+    std::memset(target, 0, N);
+    std::memcpy(target, name.data(), name.size());
+}
+
+template <size_t N>
+std::string readName(const char (&source)[N]) {
+    size_t length = strnlen(source, N);
+    if (length == N) {
+        throw std::runtime_error("Corrupt checkpoint: unterminated name");
+    }
+    return std::string(source, length);
+}
+
+// Sections queued for writing; data must stay valid until the file is written
+struct SectionWriter {
+    struct Pending {
+        std::string name;
+        const void* data;
+        uint64_t size;
+    };
+    std::vector<Pending> sections;
+
+    template <class T>
+    void add(const std::string& name, const std::vector<T>& values, size_t count) {
+        sections.push_back({ name, values.data(), count * sizeof(T) });
+    }
+    void add(const std::string& name, const void* data, uint64_t size) {
+        sections.push_back({ name, data, size });
+    }
+
+    void write(std::ostream& out, Header header) const {
+        header.sectionCount = sections.size();
+        std::vector<SectionEntry> table(sections.size());
+        uint64_t offset = alignUp(sizeof(Header) + sizeof(SectionEntry) * sections.size());
+        for (size_t i = 0; i < sections.size(); ++i) {
+            copyName(table[i].name, sections[i].name);
+            table[i].offset = offset;
+            table[i].size = sections[i].size;
+            offset = alignUp(offset + sections[i].size);
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.data()), sizeof(SectionEntry) * table.size());
+        uint64_t position = sizeof(Header) + sizeof(SectionEntry) * table.size();
+        static const char padding[sectionAlignment] = {};
+        for (size_t i = 0; i < sections.size(); ++i) {
+            out.write(padding, table[i].offset - position);
+            out.write(static_cast<const char*>(sections[i].data), sections[i].size);
+            position = table[i].offset + sections[i].size;
+        }
+    }
+};
+
+// Read-only private mapping of a whole file, with bounds-checked access to its sections
+class MappedCheckpoint {
+private:
+    int fd = -1;
+    const char* data = nullptr;
+    size_t size = 0;
+    const Header* header = nullptr;
+    const SectionEntry* table = nullptr;
+
+public:
+    explicit MappedCheckpoint(const std::string& path) {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open checkpoint " + path + ": " + std::strerror(errno));
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Cannot stat checkpoint " + path + ": " + std::strerror(error));
+        }
+        size = static_cast<size_t>(info.st_size);
+        if (size < sizeof(Header)) {
+            close(fd);
+            throw std::runtime_error(path + " is not a checkpoint");
+        }
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            int error = errno;
+            close(fd);
+            throw std::runtime_error("Cannot map checkpoint " + path + ": " + std::strerror(error));
+        }
+        data = static_cast<const char*>(mapped);
+        header = reinterpret_cast<const Header*>(data);
+        if (std::memcmp(header->magic, magic, sizeof(magic)) != 0) {
+            release();
+            throw std::runtime_error(path + " is not a checkpoint");
+        }
+        if (header->byteOrder != byteOrderMark) {
+            release();
+            throw std::runtime_error("Checkpoint " + path + " was written with another byte order");
+        }
+        if (header->version != Checkpoint::version) {
+            uint32_t found = header->version;
+            release();
+            throw std::runtime_error("Checkpoint " + path + " has version " + std::to_string(found)
+                + ", expected " + std::to_string(Checkpoint::version));
+        }
+        if (header->sectionCount > (size - sizeof(Header)) / sizeof(SectionEntry)) {
+            release();
+            throw std::runtime_error("Corrupt checkpoint " + path + ": section table past end of file");
+        }
+        table = reinterpret_cast<const SectionEntry*>(data + sizeof(Header));
+    }
+    ~MappedCheckpoint() { release(); }
+
+    MappedCheckpoint(const MappedCheckpoint&) = delete;
+    MappedCheckpoint& operator=(const MappedCheckpoint&) = delete;
+
+    void release() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+            data = nullptr;
+        }
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    const Header& getHeader() const { return *header; }
+
+    // Elements of section name, which must hold a whole number of T
+    template <class T>
+    std::pair<const T*, size_t> section(const std::string& name) const {
+        for (uint64_t i = 0; i < header->sectionCount; ++i) {
+            if (readName(table[i].name) != name) continue;
+            const SectionEntry& entry = table[i];
+            if (entry.offset > size || entry.size > size - entry.offset || entry.offset % alignof(T) != 0
+                || entry.size % sizeof(T) != 0) {
+                throw std::runtime_error("Corrupt checkpoint: bad bounds for section " + name);
+            }
+            return { reinterpret_cast<const T*>(data + entry.offset), entry.size / sizeof(T) };
+        }
+        throw std::runtime_error("Corrupt checkpoint: missing section " + name);
+    }
+
+    // Same, requiring exactly count elements
+    template <class T>
+    const T* section(const std::string& name, size_t count) const {
+        auto found = section<T>(name);
+        if (found.second != count) {
+            throw std::runtime_error("Corrupt checkpoint: section " + name + " has " + std::to_string(found.second)
+                + " elements, expected " + std::to_string(count));
+        }
+        return found.first;
+    }
+
+    // Copies section name, exactly count elements, over target
+    template <class T>
+    void load(const std::string& name, std::vector<T>& target, size_t count) const {
+        const T* values = section<T>(name, count);
+        target.assign(values, values + count);
+    }
+};
+
+}
+
+void Checkpoint::save(const Model& model, const std::string& path) {
+    TRACE_SCOPE("checkpoint", "model");
+    if (model.idStride != 1) {
+        throw std::logic_error("Checkpoints cover single-process runs only");
+    }
+    for (const auto& store : model.stores) {
+        if (store->getColumns().ghosts > 0) {
+            throw std::logic_error("Checkpoints cover single-process runs only");
+        }
+    }
+
+    Header header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byteOrder = byteOrderMark;
+    header.height = model.height;
+    header.width = model.width;
+    header.seed = model.seed;
+    header.torus = model.torus ? 1 : 0;
+    header.stepCount = model.stepCount;
+    header.counter = model.counter;
+
+    SectionWriter writer;
+    std::ostringstream rngState;
+    rngState << model.rng;
+    std::string rngText = rngState.str();
+    writer.add("rng", rngText.data(), rngText.size());
+
+    const GridFields& fields = model.fields;
+    size_t cellCount = fields.weather.size();
+    writer.add("weather", fields.weather, cellCount);
+    writer.add("water", fields.water, cellCount);
+    writer.add("soilSaturation", fields.soilSaturation, cellCount);
+    writer.add("nutrients", fields.nutrients, cellCount);
+
+    size_t indexCapacity = model.agentIndex.capacity();
+    std::vector<uint32_t> generations(indexCapacity);
+    std::vector<uint8_t> live(indexCapacity);
+    for (size_t i = 0; i < indexCapacity; ++i) {
+        generations[i] = model.agentIndex.generationAt(i);
+        live[i] = model.agentIndex.liveAt(i) ? 1 : 0;
+    }
+    const std::vector<uint32_t>& freeList = model.agentIndex.getFreeList();
+    writer.add("index.generation", generations, indexCapacity);
+    writer.add("index.live", live, indexCapacity);
+    writer.add("index.free", freeList, freeList.size());
+
+    std::vector<StoreEntry> storeEntries(model.stores.size());
+    for (size_t i = 0; i < model.stores.size(); ++i) {
+        const AgentColumns& columns = model.stores[i]->getColumns();
+        copyName(storeEntries[i].type, columns.type);
+        storeEntries[i].count = columns.size();
+    }
+    writer.add("stores", storeEntries, storeEntries.size());
+    for (const auto& store : model.stores) {
+        const AgentColumns& columns = store->getColumns();
+        size_t n = columns.size();
+        writer.add(columns.type + ".ids", columns.ids, n);
+        writer.add(columns.type + ".handles", columns.handles, n);
+        writer.add(columns.type + ".cellIndex", columns.cellIndex, n);
+        writer.add(columns.type + ".energy", columns.energy, n);
+        writer.add(columns.type + ".age", columns.age, n);
+        writer.add(columns.type + ".timer", columns.timer, n);
+        writer.add(columns.type + ".flags", columns.flags, n);
+        writer.add(columns.type + ".cellSlot", columns.cellSlot, n);
+    }
+
+    std::string partial = path + ".tmp";
+    {
+        std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Cannot write checkpoint " + partial);
+        }
+        writer.write(out, header);
+        out.close();
+        if (!out) {
+            std::remove(partial.c_str());
+            throw std::runtime_error("Error while writing checkpoint " + partial);
+        }
+    }
+    if (std::rename(partial.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        std::remove(partial.c_str());
+        throw std::runtime_error("Cannot move checkpoint to " + path + ": " + std::strerror(error));
+    }
+}
+
+std::unique_ptr<Model> Checkpoint::load(const std::string& path) {
+    TRACE_SCOPE("restore", "model");
+    MappedCheckpoint file(path);
+    const Header& header = file.getHeader();
+    if (header.height <= 0 || header.width <= 0 || header.seed > UINT16_MAX) {
+        throw std::runtime_error("Corrupt checkpoint: bad grid size or seed");
+    }
+    auto model = std::make_unique<Model>(header.height, header.width, header.torus != 0, static_cast<uint16_t>(header.seed));
+    model->stepCount = header.stepCount;
+    model->counter = header.counter;
+
+    auto rngText = file.section<char>("rng");
+    std::istringstream rngState(std::string(rngText.first, rngText.second));
+    rngState >> model->rng;
+    if (!rngState) {
+        throw std::runtime_error("Corrupt checkpoint: bad generator state");
+    }
+
+    // Grid fields. resize() counted every cell as Sunny; recount after the copy.
+    GridFields& fields = model->fields;
+    size_t cellCount = fields.weather.size();
+    fields.countWeather(0, cellCount, -1);
+    file.load("weather", fields.weather, cellCount);
+    for (uint8_t weather : fields.weather) {
+        if (weather >= weatherStateCount) {
+            throw std::runtime_error("Corrupt checkpoint: bad weather state");
+        }
+    }
+    fields.countWeather(0, cellCount, +1);
+    fields.countTotals(0, cellCount, -1);
+    file.load("water", fields.water, cellCount);
+    file.load("soilSaturation", fields.soilSaturation, cellCount);
+    file.load("nutrients", fields.nutrients, cellCount);
+    fields.countTotals(0, cellCount, +1);
+
+    // Handle index, exactly as saved so stored handles resolve and new ones are issued as before
+    auto generations = file.section<uint32_t>("index.generation");
+    size_t indexCapacity = generations.second;
+    const uint8_t* live = file.section<uint8_t>("index.live", indexCapacity);
+    auto freeList = file.section<uint32_t>("index.free");
+    for (size_t i = 0; i < freeList.second; ++i) {
+        if (freeList.first[i] >= indexCapacity || live[freeList.first[i]]) {
+            throw std::runtime_error("Corrupt checkpoint: bad free list");
+        }
+    }
+    model->agentIndex.restore(generations.first, live, indexCapacity, freeList.first, freeList.second);
+
+    // Stores in their saved order, columns copied whole, then every agent relinked to its
+    // handle and to its saved position in its cell's list
+    auto storeEntries = file.section<StoreEntry>("stores");
+    size_t placed = 0;
+    for (size_t i = 0; i < storeEntries.second; ++i) {
+        std::string type = readName(storeEntries.first[i].type);
+        size_t n = static_cast<size_t>(storeEntries.first[i].count);
+        if (n > indexCapacity) {
+            throw std::runtime_error("Corrupt checkpoint: " + type + " has more agents than handles");
+        }
+        RegisterSpecies registerSpecies = nullptr;
+        for (const auto& species : knownSpecies) {
+            if (type == species.first) registerSpecies = species.second;
+        }
+        if (!registerSpecies || model->findStore(type)) {
+            throw std::runtime_error("Corrupt checkpoint: unknown or repeated species " + type);
+        }
+        AgentTypeId typeId = ((*model).*registerSpecies)();
+        AgentStoreBase* store = model->getStore(typeId);
+        store->resize(n);
+        AgentColumns& columns = store->getColumns();
+        file.load(type + ".ids", columns.ids, n);
+        file.load(type + ".handles", columns.handles, n);
+        file.load(type + ".cellIndex", columns.cellIndex, n);
+        file.load(type + ".energy", columns.energy, n);
+        file.load(type + ".age", columns.age, n);
+        file.load(type + ".timer", columns.timer, n);
+        file.load(type + ".flags", columns.flags, n);
+        file.load(type + ".cellSlot", columns.cellSlot, n);
+
+        for (size_t slot = 0; slot < n; ++slot) {
+            Model::AgentLocation* location = model->agentIndex.get(columns.handles[slot]);
+            if (!location || location->store) {
+                throw std::runtime_error("Corrupt checkpoint: stale or repeated handle in " + type);
+            }
+            *location = { store, slot };
+            int cell = columns.cellIndex[slot];
+            uint32_t cellSlot = columns.cellSlot[slot];
+            if (cell < 0 || static_cast<size_t>(cell) >= cellCount || cellSlot >= indexCapacity) {
+                throw std::runtime_error("Corrupt checkpoint: bad cell position in " + type);
+            }
+            if (!fields.agents[cell].place(cellSlot, columns.handles[slot], typeId)) {
+                throw std::runtime_error("Corrupt checkpoint: two agents in one cell position");
+            }
+        }
+        placed += n;
+    }
+
+    // Positions were distinct, so the lists have no holes exactly when their sizes add up,
+    // and each type's bucket is then the run its agents sit in
+    size_t listed = 0;
+    for (CellAgentList& list : fields.agents) {
+        if (!list.seal()) {
+            throw std::runtime_error("Corrupt checkpoint: hole in a cell's agent list");
+        }
+        listed += list.size();
+    }
+    if (placed != model->agentIndex.size() || listed != placed) {
+        throw std::runtime_error("Corrupt checkpoint: agents, handles and cells disagree");
+    }
+    for (const auto& store : model->stores) {
+        const AgentColumns& columns = store->getColumns();
+        for (size_t slot = 0; slot < columns.size(); ++slot) {
+            const CellAgentList& list = fields.agents[columns.cellIndex[slot]];
+            HandleRange bucket = list.bucket(columns.typeId);
+            size_t begin = static_cast<size_t>(bucket.begin() - list.all().begin());
+            if (columns.cellSlot[slot] < begin || columns.cellSlot[slot] >= begin + bucket.size()) {
+                throw std::runtime_error("Corrupt checkpoint: " + columns.type + " outside its bucket");
+            }
+        }
+    }
+    return model;
+}
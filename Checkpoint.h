@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class Model;
+
+// Saves a Model to a single file and restores it, so a long run can be resumed and a restored
+// model steps exactly as the saved one would have: the grid fields, every agent's columns and
+// cell positions, the handle index, stepCount, the id counter and the setup generator are all
+// kept. Climate, scheduler and thread count are configuration, not state, and are not saved.
+// Only single-process models can be saved; a model holding ghost agents is refused.
+//
+// Layout (native byte order; the header records it and restore refuses a mismatch):
+//   Header       fixed size, see Checkpoint.cpp
+//   Section table one entry per section: a 48-byte name, a uint64 offset and a uint64 size
+//   Sections     raw arrays, each starting on a 64-byte boundary
+// The sections are "rng" (the setup generator as text), "weather", "water", "soilSaturation",
+// "nutrients" (one element per cell), "index.generation", "index.live", "index.free" (the
+// handle map), "stores" (type name and agent count per store, in store order) and, per store,
+// "<Type>.ids", ".handles", ".cellIndex", ".energy", ".age", ".timer", ".flags" and ".cellSlot".
+// Because every array sits whole and aligned in the file, restore maps the file and copies
+// each array in one go rather than parsing agents one at a time. Version 2 dropped the
+// per-agent bucket positions, which the cell lists now imply.
+class Checkpoint {
+public:
+    static constexpr uint32_t version = 2;
+
+    // Writes model to path + ".tmp" and renames it over path once complete, so an existing
+    // checkpoint survives a crash mid-write. Must not run while the model steps. Throws
+    // std::runtime_error if the file cannot be written, std::logic_error for a distributed model.
+    static void save(const Model& model, const std::string& path);
+    // Builds a model from a checkpoint. Throws std::runtime_error if the file cannot be read,
+    // is not a checkpoint of this version, or is inconsistent.
+    static std::unique_ptr<Model> load(const std::string& path);
+};
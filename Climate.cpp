@@ -0,0 +1,71 @@
+#include "Climate.h"
+#include <stdexcept>
+#include <vector>
+#include <cmath>
+
+namespace {
+
+// Tolerance for a transition row's probabilities summing to 1
+constexpr double rowSumTolerance = 1e-9;
+
+}
+
+void Climate::compile() {
+    for (int state = 0; state < weatherStateCount; ++state) {
+        auto it = effects.find(static_cast<weatherState>(state));
+        if (it == effects.end()) {
+            throw std::invalid_argument("Climate '" + type + "' has no effects for weather state " + std::to_string(state));
+        }
+        waterChangeTable[state] = it->second.waterChange;
+        evaporationTable[state] = it->second.evaporationRate;
+    }
+
+    for (int state = 0; state < weatherStateCount; ++state) {
+        auto row = transitionMatrix.find(static_cast<weatherState>(state));
+        if (row == transitionMatrix.end()) {
+            throw std::invalid_argument("Climate '" + type + "' has no transitions for weather state " + std::to_string(state));
+        }
+
+        double probabilities[weatherStateCount] = {};
+        double sum = 0.0;
+        for (const auto& [nextState, probability] : row->second) {
+            if (nextState < 0 || nextState >= weatherStateCount || probability < 0.0) {
+                throw std::invalid_argument("Climate '" + type + "' has an invalid transition from weather state " + std::to_string(state));
+            }
+            probabilities[nextState] += probability;
+            sum += probability;
+        }
+        if (std::abs(sum - 1.0) > rowSumTolerance) {
+            throw std::invalid_argument("Climate '" + type + "' transitions from weather state " + std::to_string(state)
+                + " sum to " + std::to_string(sum) + ", expected 1");
+        }
+
+        // Vose's alias method: split columns into under- and over-full, then let each
+        // under-full column borrow the remainder of its bucket from an over-full one
+        double scaled[weatherStateCount];
+        std::vector<int> small, large;
+        for (int next = 0; next < weatherStateCount; ++next) {
+            scaled[next] = probabilities[next] / sum * weatherStateCount;
+            (scaled[next] < 1.0 ? small : large).push_back(next);
+        }
+        while (!small.empty() && !large.empty()) {
+            int less = small.back();
+            small.pop_back();
+            int more = large.back();
+            large.pop_back();
+            aliasProbability[state][less] = scaled[less];
+            aliasTarget[state][less] = static_cast<uint8_t>(more);
+            scaled[more] = (scaled[more] + scaled[less]) - 1.0;
+            (scaled[more] < 1.0 ? small : large).push_back(more);
+        }
+        // Whatever is left is full up to rounding error
+        for (int next : large) {
+            aliasProbability[state][next] = 1.0;
+            aliasTarget[state][next] = static_cast<uint8_t>(next);
+        }
+        for (int next : small) {
+            aliasProbability[state][next] = 1.0;
+            aliasTarget[state][next] = static_cast<uint8_t>(next);
+        }
+    }
+}
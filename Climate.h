@@ -1,6 +1,7 @@
 #pragma once
 #include <unordered_map>
 #include <string>
+#include <cstdint>
 
 enum weatherState {
     Drought,
@@ -11,12 +12,29 @@ enum weatherState {
     Stormy
 };
 
+constexpr int weatherStateCount = 6;
+
 struct WeatherEffects {
     int waterChange;      // Water level change per step
     double evaporationRate; // Rate of water evaporation
 };
 
 struct Climate {
+    Climate() { compile(); }
+
+    // Rebuilds the dense tables below from effects and transitionMatrix; call after
+    // editing the maps. Throws std::invalid_argument if a row is missing or does not sum to 1.
+    void compile();
+
+    // Next weather for current given a uniform draw in [0, 1), in constant time
+    weatherState sampleNextWeather(weatherState current, double uniform) const {
+        double scaled = uniform * weatherStateCount;
+        int column = static_cast<int>(scaled);
+        if (column >= weatherStateCount) column = weatherStateCount - 1;
+        double fraction = scaled - column;
+        return static_cast<weatherState>(fraction < aliasProbability[current][column] ? column : aliasTarget[current][column]);
+    }
+
     std::string type = "Temperate";
     std::unordered_map<weatherState, WeatherEffects> effects = {
         {weatherState::Drought, {-2, 0.8}},
@@ -47,4 +65,12 @@ struct Climate {
             {weatherState::Rainy, 0.5}, {weatherState::Stormy, 0.3}, {weatherState::Cloudy, 0.2}
         }}
     };
+
+    // Effects indexed by weatherState, filled by compile()
+    int waterChangeTable[weatherStateCount] = {};
+    double evaporationTable[weatherStateCount] = {};
+
+    // Walker alias tables, one row per current weatherState, filled by compile()
+    double aliasProbability[weatherStateCount][weatherStateCount] = {};
+    uint8_t aliasTarget[weatherStateCount][weatherStateCount] = {};
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+// The output is a pure function of key and counter, so draws can be made from
+// any thread in any order and still come out the same.
+struct Philox4x32 {
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static Counter generate(Counter counter, Key key) {
+        for (int round = 0; round < 10; ++round) {
+            if (round > 0) {
+                key[0] += 0x9E3779B9u;
+                key[1] += 0xBB67AE85u;
+            }
+            uint64_t product0 = static_cast<uint64_t>(0xD2511F53u) * counter[0];
+            uint64_t product1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2];
+            counter = {
+                static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                static_cast<uint32_t>(product1),
+                static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                static_cast<uint32_t>(product0)
+            };
+        }
+        return counter;
+    }
+};
+
+// What a stream is used for, so one entity can draw for several things in a step
+// without the streams overlapping
+enum class RandomPurpose : uint32_t {
+    Weather,
+    Move,
+    Reproduce,
+    Death,
+    OffspringGender
+};
+
+enum class RandomDomain : uint32_t {
+    Cell,
+    Agent
+};
+
+// Sequence of 32-bit draws keyed by (seed, step, domain, entity id, purpose).
+// The draw index is the low counter word. Steps wrap after 2^32.
+// Satisfies UniformRandomBitGenerator, so it can drive std:: algorithms as well.
+class RandomStream {
+private:
+    Philox4x32::Counter counter;
+    Philox4x32::Key key;
+    Philox4x32::Counter block{};
+    int used = 4;
+
+public:
+    using result_type = uint32_t;
+
+    RandomStream(uint32_t seed, uint64_t step, RandomDomain domain, uint64_t entity, RandomPurpose purpose)
+        : counter{ 0,
+                   (static_cast<uint32_t>(domain) << 24) | static_cast<uint32_t>(purpose),
+                   static_cast<uint32_t>(entity),
+                   static_cast<uint32_t>(entity >> 32) },
+          key{ seed, static_cast<uint32_t>(step) } {
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return 0xFFFFFFFFu; }
+
+    result_type operator()() {
+        if (used == 4) {
+            block = Philox4x32::generate(counter, key);
+            counter[0]++;
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    // Uniform double in [0, 1) with 53 random bits
+    double uniform() {
+        uint64_t high = (*this)() >> 5;
+        uint64_t low = (*this)() >> 6;
+        return static_cast<double>((high << 26) | low) * (1.0 / 9007199254740992.0);
+    }
+
+    // Uniform integer in [0, bound), unbiased (Lemire's multiply-shift with rejection)
+    uint32_t below(uint32_t bound) {
+        uint64_t product = static_cast<uint64_t>((*this)()) * bound;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound) {
+            uint32_t threshold = (0u - bound) % bound;
+            while (low < threshold) {
+                product = static_cast<uint64_t>((*this)()) * bound;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+        return static_cast<uint32_t>(product >> 32);
+    }
+};
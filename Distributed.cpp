@@ -0,0 +1,400 @@
+#include "Distributed.h"
+#include "Model.h"
+#include "Trace.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace {
+
+// Fixed-layout encoding of the messages ranks trade. Every rank runs the same binary on the
+// same machine, so values are written in native byte order.
+class MessageWriter {
+private:
+    std::vector<char>& out;
+
+public:
+    explicit MessageWriter(std::vector<char>& o) : out(o) { out.clear(); }
+
+    template <class T> void put(const T& value) { putArray(&value, 1); }
+    template <class T> void putArray(const T* values, size_t count) {
+        const char* bytes = reinterpret_cast<const char*>(values);
+        out.insert(out.end(), bytes, bytes + count * sizeof(T));
+    }
+    void putString(const std::string& s) {
+        put(static_cast<uint32_t>(s.size()));
+        putArray(s.data(), s.size());
+    }
+    void putRecord(const AgentRecord& record) {
+        put(record.id);
+        put(record.cellIndex);
+        put(record.energy);
+        put(record.age);
+        put(record.timer);
+        put(record.flags);
+    }
+};
+
+class MessageReader {
+private:
+    const std::vector<char>& in;
+    size_t position = 0;
+
+public:
+    explicit MessageReader(const std::vector<char>& i) : in(i) {}
+
+    template <class T> T get() {
+        T value;
+        getArray(&value, 1);
+        return value;
+    }
+    template <class T> void getArray(T* values, size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (in.size() - position < bytes) {
+            throw std::runtime_error("truncated message from a peer rank");
+        }
+        std::memcpy(values, in.data() + position, bytes);
+        position += bytes;
+    }
+    std::string getString() {
+        std::string s(get<uint32_t>(), '\0');
+        getArray(s.data(), s.size());
+        return s;
+    }
+    AgentRecord getRecord() {
+        AgentRecord record;
+        record.id = get<long long int>();
+        record.cellIndex = get<int>();
+        record.energy = get<int>();
+        record.age = get<int>();
+        record.timer = get<int>();
+        record.flags = get<uint8_t>();
+        return record;
+    }
+};
+
+// Rank 0 to the others in an interactive run: run one step, or leave the loop
+constexpr char stepCommand = 'S';
+constexpr char stopCommand = 'Q';
+
+AgentRecord recordAt(const AgentColumns& columns, size_t slot) {
+    AgentRecord record;
+    record.id = columns.ids[slot];
+    record.cellIndex = columns.cellIndex[slot];
+    record.energy = columns.energy[slot];
+    record.age = columns.age[slot];
+    record.timer = columns.timer[slot];
+    record.flags = columns.flags[slot];
+    return record;
+}
+
+}
+
+DistributedRank::DistributedRank(Model& m, Transport& t) : model(m), transport(t) {
+    int height = model.getHeight();
+    int ranks = transport.getRankCount();
+    int rank = transport.getRank();
+    if (height < ranks) {
+        throw std::invalid_argument("a distributed run needs at least one row per process");
+    }
+
+    std::vector<int> stripBegin(ranks + 1);
+    for (int r = 0; r <= ranks; ++r) {
+        stripBegin[r] = static_cast<int>(static_cast<long long>(r) * height / ranks);
+    }
+    rowBegin = stripBegin[rank];
+    rowEnd = stripBegin[rank + 1];
+    rowOwner.resize(height);
+    for (int r = 0; r < ranks; ++r) {
+        for (int x = stripBegin[r]; x < stripBegin[r + 1]; ++x) rowOwner[x] = r;
+    }
+
+    int halo = 0;
+    for (const auto& store : model.getStores()) {
+        halo = std::max(halo, store->getInteractionRange());
+    }
+    // Rows within halo of a strip that another rank owns
+    auto haloRows = [&](int r) {
+        std::set<int> rows;
+        for (int d = 1; d <= halo; ++d) {
+            for (int x : { stripBegin[r] - d, stripBegin[r + 1] - 1 + d }) {
+                if (model.isTorus()) {
+                    x = ((x % height) + height) % height;
+                }
+                else if (x < 0 || x >= height) {
+                    continue;
+                }
+                if (rowOwner[x] != r) rows.insert(x);
+            }
+        }
+        return rows;
+    };
+
+    // Distance between strips is symmetric, so both sides agree on who their peers are
+    for (int x : haloRows(rank)) {
+        peers.push_back(rowOwner[x]);
+    }
+    std::sort(peers.begin(), peers.end());
+    peers.erase(std::unique(peers.begin(), peers.end()), peers.end());
+    peerIndex.assign(ranks, -1);
+    sendRows.resize(peers.size());
+    rowPeers.resize(height);
+    for (size_t p = 0; p < peers.size(); ++p) {
+        peerIndex[peers[p]] = static_cast<int>(p);
+        for (int x : haloRows(peers[p])) {
+            if (rowOwner[x] == rank) {
+                sendRows[p].push_back(x);
+                rowPeers[x].push_back(static_cast<int>(p));
+            }
+        }
+    }
+
+    size_t storeCount = model.getStores().size();
+    migrants.assign(peers.size(), std::vector<std::vector<AgentRecord>>(storeCount));
+    ghosts.assign(peers.size(), std::vector<std::vector<AgentRecord>>(storeCount));
+    outgoing.resize(peers.size());
+    incoming.resize(peers.size());
+}
+
+void DistributedRank::partition() {
+    model.setOwnedRows(rowBegin, rowEnd);
+    // Every rank numbered the shared initial population identically; from here on ids are interleaved
+    model.setIdStride(transport.getRank(), transport.getRankCount());
+    int width = model.getWidth();
+    for (const auto& store : model.getStores()) {
+        AgentColumns& columns = store->getColumns();
+        for (size_t slot = columns.activeSize(); slot-- > 0;) {
+            if (!model.ownsRow(columns.cellIndex[slot] / width)) {
+                model.evictAgent(columns.handles[slot]);
+            }
+        }
+    }
+    exchange();
+}
+
+void DistributedRank::exchange() {
+    TRACE_SCOPE("exchange", "distributed");
+    const auto& stores = model.getStores();
+    int width = model.getWidth();
+    GridFields& fields = model.getFields();
+
+    for (size_t p = 0; p < peers.size(); ++p) {
+        for (size_t s = 0; s < stores.size(); ++s) {
+            migrants[p][s].clear();
+            ghosts[p][s].clear();
+        }
+    }
+
+    for (size_t s = 0; s < stores.size(); ++s) {
+        AgentColumns& columns = stores[s]->getColumns();
+        // Agents that left the strip go to the owner of their new row. Walking down from the
+        // end means the agent swapped into an evicted slot has already been looked at.
+        for (size_t slot = columns.activeSize(); slot-- > 0;) {
+            int row = columns.cellIndex[slot] / width;
+            if (model.ownsRow(row)) continue;
+            int p = peerIndex[rowOwner[row]];
+            if (p < 0) {
+                throw std::logic_error("an agent moved farther than its interaction range");
+            }
+            migrants[p][s].push_back(recordAt(columns, slot));
+            model.evictAgent(columns.handles[slot]);
+            migrationsSent++;
+        }
+        // Copies of the agents a peer's halo can see
+        for (size_t slot = 0; slot < columns.activeSize(); ++slot) {
+            for (int p : rowPeers[columns.cellIndex[slot] / width]) {
+                ghosts[p][s].push_back(recordAt(columns, slot));
+            }
+        }
+    }
+
+    for (size_t p = 0; p < peers.size(); ++p) {
+        MessageWriter writer(outgoing[p]);
+        writer.put(static_cast<uint32_t>(stores.size()));
+        for (size_t s = 0; s < stores.size(); ++s) {
+            writer.putString(stores[s]->getType());
+            writer.put(static_cast<uint32_t>(migrants[p][s].size()));
+            for (const AgentRecord& record : migrants[p][s]) writer.putRecord(record);
+            writer.put(static_cast<uint32_t>(ghosts[p][s].size()));
+            for (const AgentRecord& record : ghosts[p][s]) writer.putRecord(record);
+        }
+        writer.put(static_cast<uint32_t>(sendRows[p].size()));
+        for (int row : sendRows[p]) {
+            size_t offset = static_cast<size_t>(row) * width;
+            writer.put(row);
+            writer.putArray(fields.weather.data() + offset, width);
+            writer.putArray(fields.water.data() + offset, width);
+            writer.putArray(fields.soilSaturation.data() + offset, width);
+            writer.putArray(fields.nutrients.data() + offset, width);
+        }
+    }
+
+    // Ascending peer order on every rank, see Transport::exchange
+    for (size_t p = 0; p < peers.size(); ++p) {
+        transport.exchange(peers[p], outgoing[p], incoming[p]);
+    }
+
+    // Owned arrivals first: ghosts have to sit behind every owned agent of their store
+    arrivingGhosts.clear();
+    for (size_t p = 0; p < peers.size(); ++p) {
+        MessageReader reader(incoming[p]);
+        uint32_t storeCount = reader.get<uint32_t>();
+        for (uint32_t s = 0; s < storeCount; ++s) {
+            AgentStoreBase* store = model.findStore(reader.getString());
+            uint32_t arriving = reader.get<uint32_t>();
+            for (uint32_t i = 0; i < arriving; ++i) {
+                AgentRecord record = reader.getRecord();
+                if (store) model.placeAgent(store, record);
+            }
+            uint32_t ghostCount = reader.get<uint32_t>();
+            for (uint32_t i = 0; i < ghostCount; ++i) {
+                AgentRecord record = reader.getRecord();
+                if (store) arrivingGhosts.emplace_back(store, record);
+            }
+        }
+        uint32_t rowCount = reader.get<uint32_t>();
+        for (uint32_t i = 0; i < rowCount; ++i) {
+            size_t offset = static_cast<size_t>(reader.get<int>()) * width;
+            fields.countWeather(offset, offset + width, -1);
+            reader.getArray(fields.weather.data() + offset, width);
+            fields.countWeather(offset, offset + width, +1);
+            fields.countTotals(offset, offset + width, -1);
+            reader.getArray(fields.water.data() + offset, width);
+            reader.getArray(fields.soilSaturation.data() + offset, width);
+            reader.getArray(fields.nutrients.data() + offset, width);
+            fields.countTotals(offset, offset + width, +1);
+        }
+    }
+    for (const auto& [store, record] : arrivingGhosts) {
+        model.placeAgent(store, record, true);
+    }
+
+    transport.barrier();
+}
+
+int runDistributed(const DistributedOptions& options, const std::function<std::unique_ptr<Model>()>& build) {
+    int ranks = std::max(1, options.processes);
+    std::unique_ptr<Transport> transport = Transport::create(options.transport, ranks);
+
+    int rank = 0;
+    std::vector<pid_t> children;
+    for (int r = 1; r < ranks; ++r) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            throw std::runtime_error("fork failed");
+        }
+        if (pid == 0) {
+            rank = r;
+            children.clear();
+            // The parent's events up to the fork belong to rank 0's trace
+            Trace::clear();
+            break;
+        }
+        children.push_back(pid);
+    }
+
+    int status = 0;
+    try {
+        transport->bind(rank);
+        std::unique_ptr<Model> model = build();
+        DistributedRank share(*model, *transport);
+        share.partition();
+        model->setStepHook([&share] { share.exchange(); });
+
+        auto start = std::chrono::steady_clock::now();
+        if (!options.interactive) {
+            model->step(options.steps);
+        }
+        else if (rank == 0) {
+            std::vector<char> command(1, stepCommand);
+            model->setStepStartHook([&] {
+                for (int r = 1; r < ranks; ++r) transport->send(r, command);
+            });
+            model->initializeSimulation();
+            model->setStepStartHook(nullptr);
+            command[0] = stopCommand;
+            for (int r = 1; r < ranks; ++r) transport->send(r, command);
+        }
+        else {
+            std::vector<char> command;
+            while (true) {
+                transport->receive(0, command);
+                if (command.empty() || command[0] != stepCommand) break;
+                model->step();
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Rank 0 adds up everyone's population
+        std::vector<char> summary;
+        MessageWriter writer(summary);
+        writer.put(static_cast<uint32_t>(model->getStores().size()));
+        for (const auto& store : model->getStores()) {
+            writer.putString(store->getType());
+            writer.put(static_cast<uint64_t>(store->activeSize()));
+        }
+        writer.put(static_cast<uint64_t>(share.getMigrationsSent()));
+        if (rank == 0) {
+            std::map<std::string, uint64_t> agentCounts;
+            uint64_t migrations = 0;
+            for (int r = 0; r < ranks; ++r) {
+                std::vector<char> message;
+                if (r == 0) message = summary;
+                else transport->receive(r, message);
+                MessageReader reader(message);
+                uint32_t storeCount = reader.get<uint32_t>();
+                for (uint32_t s = 0; s < storeCount; ++s) {
+                    std::string type = reader.getString();
+                    agentCounts[type] += reader.get<uint64_t>();
+                }
+                migrations += reader.get<uint64_t>();
+            }
+            std::cout << "\n--- Distributed run ---\n";
+            std::cout << "Processes: " << ranks << " ("
+                << (options.transport == TransportKind::Socket ? "socket" : "shared memory") << ")\n";
+            std::cout << "Steps: " << model->getStepCount() << " in " << seconds << " s\n";
+            std::cout << "Agent Types:\n";
+            for (const auto& [type, count] : agentCounts) {
+                std::cout << "  " << type << ": " << count << "\n";
+            }
+            std::cout << "Migrations: " << migrations << "\n";
+            std::cout << "----------------\n";
+        }
+        else {
+            transport->send(0, summary);
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "[Rank " << rank << "] " << e.what() << std::endl;
+        status = 1;
+    }
+
+    if (!options.tracePath.empty()) {
+        std::string path = options.tracePath + ".rank" + std::to_string(rank);
+        std::ofstream out(path);
+        if (out) {
+            Trace::writeJson(out, rank + 1);
+            std::cout << "[Rank " << rank << "] Trace written to " << path << std::endl;
+        }
+        else {
+            std::cerr << "[Rank " << rank << "] Cannot write " << path << std::endl;
+        }
+    }
+    if (rank != 0) {
+        std::cout.flush();
+        _exit(status);
+    }
+    for (pid_t pid : children) {
+        int childStatus = 0;
+        if (waitpid(pid, &childStatus, 0) < 0 || !WIFEXITED(childStatus) || WEXITSTATUS(childStatus) != 0) {
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include "AgentStore.h"
+#include "Transport.h"
+
+class Model;
+
+struct DistributedOptions {
+    int processes = 2;
+    TransportKind transport = TransportKind::SharedMemory;
+    int steps = 100;
+    // Rank 0 runs the CLI and Model::loop() instead of a fixed number of steps, and the other
+    // ranks step whenever it does
+    bool interactive = false;
+    // If set, every rank writes the timeline it recorded to tracePath + ".rank<N>" on exit
+    std::string tracePath;
+};
+
+// One process's share of a distributed run. Rank r owns a horizontal strip of rows and steps
+// the environment and the agents there. After every step it hands agents that left the strip
+// to their new owner, and sends each neighbouring rank the cells and agents of its own rows
+// that lie in that rank's halo (the rows within the largest interaction range of its strip).
+// The neighbour keeps those agents as ghosts for one step: visible to its agents, never stepped,
+// and never hunted or chosen as a mate, since an effect on a copy would be lost with it.
+//
+// Cells in another rank's strip are only ever read, so they need no reconciliation; an agent
+// that moves or is born onto one simply migrates.
+class DistributedRank {
+private:
+    Model& model;
+    Transport& transport;
+    int rowBegin = 0;
+    int rowEnd = 0;
+    std::vector<int> rowOwner;
+    std::vector<int> peers;                  // ranks within halo distance of this strip, ascending
+    std::vector<int> peerIndex;              // rank -> position in peers, or -1
+    std::vector<std::vector<int>> sendRows;  // per peer: rows of this strip inside that peer's halo
+    std::vector<std::vector<int>> rowPeers;  // per row: peers it is sent to
+
+    // Per peer, per store, reused from step to step
+    std::vector<std::vector<std::vector<AgentRecord>>> migrants;
+    std::vector<std::vector<std::vector<AgentRecord>>> ghosts;
+    std::vector<std::vector<char>> outgoing;
+    std::vector<std::vector<char>> incoming;
+    std::vector<std::pair<AgentStoreBase*, AgentRecord>> arrivingGhosts;
+    size_t migrationsSent = 0;
+
+public:
+    DistributedRank(Model& m, Transport& t);
+
+    // Drops every agent outside this rank's strip and trades the first ghosts
+    void partition();
+    // Migrants, halo cells and ghosts with every peer, then the step barrier. Runs after each step.
+    void exchange();
+
+    size_t getMigrationsSent() const { return migrationsSent; }
+};
+
+// Runs options.steps steps, or an interactive session, over options.processes processes on this
+// machine. build() is called once in every process and must construct the same model each time,
+// population included. Forks, so call it before any other thread is started. Rank 0 prints the
+// combined population and returns 0 once every rank has finished, or 1 if any of them failed.
+//
+// Interactively, rank 0's Model::loop() drives the run: at the start of each step it tells every
+// other rank to step, and the exchange after the step ends on the barrier, so no rank starts
+// step n + 1 before all have finished step n. CLI commands act on rank 0's model and strip.
+int runDistributed(const DistributedOptions& options, const std::function<std::unique_ptr<Model>()>& build);
@@ -0,0 +1,140 @@
+#include "Ensemble.h"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "Population.h"
+#include "ThreadPool.h"
+#include "Tree.h"
+#include "Worm.h"
+#include "Bird.h"
+
+namespace {
+
+// Agent count per type id (then the total) before the first step and after every step
+using RunCounts = std::vector<std::vector<size_t>>;
+
+void recordCounts(const Model& model, size_t typeCount, RunCounts& counts) {
+    std::vector<size_t> row(typeCount + 1, 0);
+    for (size_t type = 0; type < typeCount; ++type) {
+        if (const AgentStoreBase* store = model.getStore(static_cast<AgentTypeId>(type))) {
+            row[type] = store->activeSize();
+            row[typeCount] += row[type];
+        }
+    }
+    counts.push_back(std::move(row));
+}
+
+EnsembleSeries::Summary summarize(const std::vector<RunCounts>& runs, size_t first, size_t count, size_t step, size_t column) {
+    EnsembleSeries::Summary summary;
+    summary.min = runs[first][step][column];
+    double sum = 0;
+    for (size_t r = first; r < first + count; ++r) {
+        size_t value = runs[r][step][column];
+        sum += static_cast<double>(value);
+        summary.min = std::min(summary.min, value);
+        summary.max = std::max(summary.max, value);
+    }
+    summary.mean = sum / count;
+    double squares = 0;
+    for (size_t r = first; r < first + count; ++r) {
+        double d = static_cast<double>(runs[r][step][column]) - summary.mean;
+        squares += d * d;
+    }
+    summary.stddev = std::sqrt(squares / count);
+    return summary;
+}
+
+}
+
+EnsembleResult runEnsemble(const EnsembleSpec& spec) {
+    EnsembleResult result;
+    if (spec.seeds.empty() || spec.variants.empty()) {
+        return result;
+    }
+
+    // Intern the species up front so every run sees the same type ids whichever builds first
+    agentTypeId<Tree>();
+    agentTypeId<Worm>();
+    agentTypeId<Bird>();
+    size_t typeCount = AgentTypes::count();
+
+    // Runs are laid out variant-major, so each variant's seeds are contiguous
+    size_t seedCount = spec.seeds.size();
+    result.runs = spec.variants.size() * seedCount;
+    std::vector<RunCounts> counts(result.runs);
+    std::vector<unsigned long long> updates(result.runs, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    ThreadPool pool(std::max(1u, spec.threads));
+    pool.parallelFor(result.runs, [&](size_t run) {
+        const EnsembleVariant& variant = spec.variants[run / seedCount];
+        Model model(spec.height, spec.width, spec.torus, spec.seeds[run % seedCount]);
+        model.setScheduler(spec.scheduler);
+        if (variant.climate) {
+            model.setClimate(variant.climate);
+        }
+        populate(model, variant.trees, variant.worms, variant.birds);
+
+        RunCounts& runCounts = counts[run];
+        runCounts.reserve(static_cast<size_t>(spec.steps) + 1);
+        recordCounts(model, typeCount, runCounts);
+        for (int step = 0; step < spec.steps; ++step) {
+            updates[run] += model.getAgentCount();
+            model.step();
+            recordCounts(model, typeCount, runCounts);
+        }
+    });
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (unsigned long long u : updates) {
+        result.agentUpdates += u;
+    }
+
+    for (size_t v = 0; v < spec.variants.size(); ++v) {
+        EnsembleSeries series;
+        series.variant = spec.variants[v].name;
+        for (size_t type = 0; type < typeCount; ++type) {
+            series.columns.push_back(AgentTypes::name(static_cast<AgentTypeId>(type)));
+        }
+        series.columns.push_back("Total");
+        series.stats.resize(static_cast<size_t>(spec.steps) + 1);
+        for (size_t step = 0; step < series.stats.size(); ++step) {
+            for (size_t column = 0; column < series.columns.size(); ++column) {
+                series.stats[step].push_back(summarize(counts, v * seedCount, seedCount, step, column));
+            }
+        }
+        result.series.push_back(std::move(series));
+    }
+    return result;
+}
+
+void printEnsembleSummary(const EnsembleResult& result) {
+    std::cout << "\n--- Ensemble run ---\n";
+    std::cout << "Runs: " << result.runs << " in " << result.seconds << " s\n";
+    std::cout << "Runs/s: " << (result.seconds > 0 ? result.runs / result.seconds : 0.0) << "\n";
+    std::cout << "Agent updates/s: " << (result.seconds > 0 ? result.agentUpdates / result.seconds : 0.0) << "\n";
+    for (const EnsembleSeries& series : result.series) {
+        if (series.stats.empty()) continue;
+        std::cout << "Variant " << series.variant << ", step " << series.stats.size() - 1 << ":\n";
+        const auto& last = series.stats.back();
+        for (size_t column = 0; column < series.columns.size(); ++column) {
+            std::cout << "  " << series.columns[column] << ": " << last[column].mean
+                << " +/- " << last[column].stddev
+                << " [" << last[column].min << ", " << last[column].max << "]\n";
+        }
+    }
+    std::cout << "--------------------\n";
+}
+
+void writeEnsembleCsv(const EnsembleResult& result, std::ostream& out) {
+    out << "variant,step,column,mean,stddev,min,max\n";
+    for (const EnsembleSeries& series : result.series) {
+        for (size_t step = 0; step < series.stats.size(); ++step) {
+            for (size_t column = 0; column < series.columns.size(); ++column) {
+                const EnsembleSeries::Summary& s = series.stats[step][column];
+                out << series.variant << ',' << step << ',' << series.columns[column] << ','
+                    << s.mean << ',' << s.stddev << ',' << s.min << ',' << s.max << '\n';
+            }
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <ostream>
+#include <cstdint>
+#include "Model.h"
+
+// One point of a parameter sweep: the populations and climate every seed is run with
+struct EnsembleVariant {
+    std::string name = "base";
+    int trees = 100;
+    int worms = 1000;
+    int birds = 50;
+    // Compiled once and read by every model of the variant; null for the default climate
+    std::shared_ptr<const Climate> climate;
+};
+
+// Every variant is run once per seed, for steps steps on a height x width grid
+struct EnsembleSpec {
+    int height = 10;
+    int width = 10;
+    bool torus = true;
+    Scheduler scheduler = Scheduler::Sequential;
+    int steps = 100;
+    std::vector<uint16_t> seeds;
+    std::vector<EnsembleVariant> variants;
+    // Models run concurrently; each one steps on a single thread
+    unsigned threads = 1;
+};
+
+// Per-step agent counts over the seeds of one variant
+struct EnsembleSeries {
+    struct Summary {
+        double mean = 0;
+        double stddev = 0;
+        size_t min = 0;
+        size_t max = 0;
+    };
+    std::string variant;
+    // One column per agent type, then "Total"
+    std::vector<std::string> columns;
+    // stats[step][column]; step 0 is the initial population
+    std::vector<std::vector<Summary>> stats;
+};
+
+struct EnsembleResult {
+    std::vector<EnsembleSeries> series;  // one per variant, in spec order
+    size_t runs = 0;
+    double seconds = 0;
+    unsigned long long agentUpdates = 0;
+};
+
+// Builds and steps every (variant, seed) model concurrently, then aggregates their counts in
+// seed order, so the result depends only on spec and not on threads or completion order
+EnsembleResult runEnsemble(const EnsembleSpec& spec);
+// Final-step mean and spread per variant, plus throughput
+void printEnsembleSummary(const EnsembleResult& result);
+// Header, then one row per variant, step and column: variant,step,column,mean,stddev,min,max
+void writeEnsembleCsv(const EnsembleResult& result, std::ostream& out);
@@ -0,0 +1,167 @@
+#include "EnvironmentKernel.h"
+#include "Cell.h"
+
+// The vector paths are compiled for their own targets whatever the build flags say, and
+// picked at run time from what the CPU supports
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NHAGW_KERNEL_X86 1
+#include <immintrin.h>
+#else
+#define NHAGW_KERNEL_X86 0
+#endif
+
+namespace {
+
+#if NHAGW_KERNEL_X86
+
+// Eight cells per iteration. Rates are converted exactly as the scalar path does:
+// int -> double, multiply, truncate back to int, so the results match bit for bit.
+// The change in water is added to waterChange.
+__attribute__((target("avx2")))
+size_t updateWaterAndSoilAvx2(int* water, int* soil, const uint8_t* weather, const Climate& climate, size_t count, int maxSoilSaturation, long long& waterChange) {
+    alignas(32) int changes[8] = {};
+    for (int state = 0; state < weatherStateCount; ++state) {
+        changes[state] = climate.waterChangeTable[state];
+    }
+    const __m256i changeTable = _mm256_load_si256(reinterpret_cast<const __m256i*>(changes));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i maxSoil = _mm256_set1_epi32(maxSoilSaturation);
+    const __m256d allLanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    __m256i changeSum = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i state = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(weather + i)));
+        __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(water + i));
+        __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(soil + i));
+        __m256i before = w;
+
+        w = _mm256_max_epi32(_mm256_add_epi32(w, _mm256_permutevar8x32_epi32(changeTable, state)), zero);
+
+        __m128i stateLo = _mm256_castsi256_si128(state);
+        __m128i stateHi = _mm256_extracti128_si256(state, 1);
+        __m256d rateLo = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), climate.evaporationTable, stateLo, allLanes, 8);
+        __m256d rateHi = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), climate.evaporationTable, stateHi, allLanes, 8);
+        __m128i evapLo = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(w)), rateLo));
+        __m128i evapHi = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(w, 1)), rateHi));
+        __m256i evaporation = _mm256_inserti128_si256(_mm256_castsi128_si256(evapLo), evapHi, 1);
+        w = _mm256_max_epi32(_mm256_sub_epi32(w, evaporation), zero);
+
+        __m256i absorb = _mm256_and_si256(_mm256_cmpgt_epi32(w, zero), _mm256_cmpgt_epi32(maxSoil, s));
+        absorb = _mm256_and_si256(absorb, one);
+        s = _mm256_add_epi32(s, absorb);
+        w = _mm256_sub_epi32(w, absorb);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(water + i), w);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(soil + i), s);
+        // Widened to 64 bits before summing, so no row is long enough to overflow
+        __m256i delta = _mm256_sub_epi32(w, before);
+        changeSum = _mm256_add_epi64(changeSum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(delta)));
+        changeSum = _mm256_add_epi64(changeSum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(delta, 1)));
+    }
+    alignas(32) long long lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), changeSum);
+    waterChange += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    return i;
+}
+
+// Four cells per iteration; table lookups are scalar since SSE has no variable permute
+__attribute__((target("sse4.1")))
+size_t updateWaterAndSoilSse41(int* water, int* soil, const uint8_t* weather, const Climate& climate, size_t count, int maxSoilSaturation, long long& waterChange) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i maxSoil = _mm_set1_epi32(maxSoilSaturation);
+    const int* changes = climate.waterChangeTable;
+    const double* rates = climate.evaporationTable;
+    __m128i changeSum = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint8_t* st = weather + i;
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(water + i));
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(soil + i));
+        __m128i before = w;
+
+        __m128i change = _mm_setr_epi32(changes[st[0]], changes[st[1]], changes[st[2]], changes[st[3]]);
+        w = _mm_max_epi32(_mm_add_epi32(w, change), zero);
+
+        __m128d rateLo = _mm_setr_pd(rates[st[0]], rates[st[1]]);
+        __m128d rateHi = _mm_setr_pd(rates[st[2]], rates[st[3]]);
+        __m128i evapLo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(w), rateLo));
+        __m128i evapHi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(w, 8)), rateHi));
+        __m128i evaporation = _mm_unpacklo_epi64(evapLo, evapHi);
+        w = _mm_max_epi32(_mm_sub_epi32(w, evaporation), zero);
+
+        __m128i absorb = _mm_and_si128(_mm_cmpgt_epi32(w, zero), _mm_cmpgt_epi32(maxSoil, s));
+        absorb = _mm_and_si128(absorb, one);
+        s = _mm_add_epi32(s, absorb);
+        w = _mm_sub_epi32(w, absorb);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(water + i), w);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(soil + i), s);
+        __m128i delta = _mm_sub_epi32(w, before);
+        changeSum = _mm_add_epi64(changeSum, _mm_cvtepi32_epi64(delta));
+        changeSum = _mm_add_epi64(changeSum, _mm_cvtepi32_epi64(_mm_srli_si128(delta, 8)));
+    }
+    waterChange += _mm_extract_epi64(changeSum, 0) + _mm_extract_epi64(changeSum, 1);
+    return i;
+}
+
+#endif
+
+KernelPath detectKernelPath() {
+#if NHAGW_KERNEL_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return KernelPath::Avx2;
+    if (__builtin_cpu_supports("sse4.1")) return KernelPath::Sse41;
+#endif
+    return KernelPath::Scalar;
+}
+
+}
+
+KernelPath bestKernelPath() {
+    static const KernelPath best = detectKernelPath();
+    return best;
+}
+
+bool kernelPathSupported(KernelPath path) {
+    return static_cast<int>(path) <= static_cast<int>(bestKernelPath());
+}
+
+const char* kernelPathName(KernelPath path) {
+    switch (path) {
+    case KernelPath::Avx2: return "avx2";
+    case KernelPath::Sse41: return "sse4.1";
+    default: return "scalar";
+    }
+}
+
+long long updateWaterAndSoilBatch(GridFields& fields, const Climate& climate, size_t begin, size_t end, int maxSoilSaturation) {
+    return updateWaterAndSoilBatch(bestKernelPath(), fields, climate, begin, end, maxSoilSaturation);
+}
+
+long long updateWaterAndSoilBatch(KernelPath path, GridFields& fields, const Climate& climate, size_t begin, size_t end, int maxSoilSaturation) {
+    int* water = fields.water.data() + begin;
+    int* soil = fields.soilSaturation.data() + begin;
+    const uint8_t* weather = fields.weather.data() + begin;
+    size_t count = end - begin;
+
+    size_t done = 0;
+    long long waterChange = 0;
+#if NHAGW_KERNEL_X86
+    if (path == KernelPath::Avx2) {
+        done = updateWaterAndSoilAvx2(water, soil, weather, climate, count, maxSoilSaturation, waterChange);
+    }
+    else if (path == KernelPath::Sse41) {
+        done = updateWaterAndSoilSse41(water, soil, weather, climate, count, maxSoilSaturation, waterChange);
+    }
+#endif
+    for (size_t i = done; i < count; ++i) {
+        int before = water[i];
+        updateWaterAndSoil(water[i], soil[i], weather[i], climate, maxSoilSaturation);
+        waterChange += water[i] - before;
+    }
+    return waterChange;
+}
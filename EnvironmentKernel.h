@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "Climate.h"
+
+struct GridFields;
+
+// Water, evaporation and soil saturation update for a single cell. This is the
+// reference the vector paths below must reproduce exactly.
+inline void updateWaterAndSoil(int& water, int& soilSaturation, uint8_t weather, const Climate& climate, int maxSoilSaturation) {
+    // Update water level based on weather effects
+    water = water + climate.waterChangeTable[weather];
+    if (water < 0) water = 0;
+    // Simulate evaporation
+    int evaporation = static_cast<int>(water * climate.evaporationTable[weather]);
+    water = water - evaporation;
+    if (water < 0) water = 0;
+    // Update soil saturation based on water
+    if (water > 0 && soilSaturation < maxSoilSaturation) {
+        soilSaturation++;
+        water--;
+    }
+}
+
+// Ways updateWaterAndSoilBatch can run, narrowest first. Every path gives bit-identical results.
+enum class KernelPath { Scalar, Sse41, Avx2 };
+
+// Widest path this CPU supports, detected once at run time, so a plain build uses the vector
+// paths without -mavx2 or -msse4.1
+KernelPath bestKernelPath();
+bool kernelPathSupported(KernelPath path);
+const char* kernelPathName(KernelPath path);
+
+// Applies updateWaterAndSoil to cells [begin, end) of fields, eight (AVX2) or four (SSE4.1)
+// cells at a time on bestKernelPath(), with the scalar version for the tail.
+// Returns the change in the water summed over those cells.
+long long updateWaterAndSoilBatch(GridFields& fields, const Climate& climate, size_t begin, size_t end, int maxSoilSaturation);
+// Same on a given, supported path; bench --verify uses it to check the vector paths against
+// the scalar one
+long long updateWaterAndSoilBatch(KernelPath path, GridFields& fields, const Climate& climate, size_t begin, size_t end, int maxSoilSaturation);
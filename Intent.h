@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "AgentStore.h"
+
+class Model;
+
+// Finds (or creates) the store a queued birth belongs in; resolved on the model thread
+using StoreResolver = AgentStoreBase* (*)(Model*);
+
+// A change an agent's act() wants to make to something other than its own columns.
+// In the parallel scheduler these are collected during act and applied afterwards.
+struct Intent {
+    enum class Kind : uint8_t {
+        Move,                  // agent moves to cellIndex
+        ModifyNutrients,       // cellIndex nutrients += amount
+        ModifyWater,           // cellIndex water += amount
+        ModifySoilSaturation,  // cellIndex soilSaturation += amount
+        Eat,                   // agent takes up to amount nutrients from cellIndex, energy capped at limit
+        Prey,                  // agent eats target for amount energy, capped at limit; first claim wins
+        TransferEnergy         // agent energy += amount
+    };
+
+    Kind kind = Kind::Move;
+    AgentHandle agent;
+    AgentHandle target;
+    int cellIndex = -1;
+    int amount = 0;
+    int limit = 0;
+};
+
+struct QueuedBirth {
+    StoreResolver resolve;
+    AgentRecord record;
+};
+
+// Everything one chunk of agents emitted during a parallel act phase, in emission order.
+// Buffers are reused from step to step so their capacity is kept.
+struct IntentBuffer {
+    std::vector<Intent> intents;
+    std::vector<QueuedBirth> births;
+    std::vector<AgentHandle> deaths;
+
+    void move(AgentHandle agent, int cellIndex) {
+        Intent intent;
+        intent.kind = Intent::Kind::Move;
+        intent.agent = agent;
+        intent.cellIndex = cellIndex;
+        intents.push_back(intent);
+    }
+    void modifyCell(Intent::Kind kind, int cellIndex, int amount) {
+        Intent intent;
+        intent.kind = kind;
+        intent.cellIndex = cellIndex;
+        intent.amount = amount;
+        intents.push_back(intent);
+    }
+    void eat(AgentHandle agent, int cellIndex, int amount, int limit) {
+        Intent intent;
+        intent.kind = Intent::Kind::Eat;
+        intent.agent = agent;
+        intent.cellIndex = cellIndex;
+        intent.amount = amount;
+        intent.limit = limit;
+        intents.push_back(intent);
+    }
+    void prey(AgentHandle predator, AgentHandle prey, int amount, int limit) {
+        Intent intent;
+        intent.kind = Intent::Kind::Prey;
+        intent.agent = predator;
+        intent.target = prey;
+        intent.amount = amount;
+        intent.limit = limit;
+        intents.push_back(intent);
+    }
+    void transferEnergy(AgentHandle agent, int amount) {
+        Intent intent;
+        intent.kind = Intent::Kind::TransferEnergy;
+        intent.agent = agent;
+        intent.amount = amount;
+        intents.push_back(intent);
+    }
+
+    void clear() {
+        intents.clear();
+        births.clear();
+        deaths.clear();
+    }
+};
@@ -2,19 +2,46 @@
 #include "Agent.h"
 #include "Cell.h"
 #include "CLI.h"
+#include "EnvironmentKernel.h"
+#include "Tree.h"
+#include "Trace.h"
+#include "TimeSeries.h"
+#include "Checkpoint.h"
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <stdexcept>
+
+thread_local IntentBuffer* Model::activeIntents = nullptr;
+thread_local const Model::Subdomain* Model::activeDomain = nullptr;
+thread_local FieldTally* Model::activeTally = nullptr;
+
+namespace {
+
+// Built on first use and shared by every model that is not given a climate of its own
+const std::shared_ptr<const Climate>& defaultClimate() {
+    static const std::shared_ptr<const Climate> climate = std::make_shared<const Climate>();
+    return climate;
+}
+
+}
 
 Model::Model(int h, int w, bool t, uint16_t s)
-    : height(h), width(w), torus(t), rng(s) {
-    grid.resize(height, std::vector<Cell>(width));
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            grid[i][j].initialize(this, i, j);
-        }
+    : height(h), width(w), torus(t), rng(s), seed(s), ownedRowEnd(h), climate(defaultClimate()) {
+    int cellCount = height * width;
+    fields.resize(cellCount);
+    grid.resize(cellCount);
+    for (int i = 0; i < cellCount; ++i) {
+        grid[i].initialize(this, &fields, i);
     }
 }
 
+void Model::setClimate(const Climate& newClimate) {
+    auto compiled = std::make_shared<Climate>(newClimate);
+    compiled->compile();
+    climate = std::move(compiled);
+}
+
 void Model::initializeSimulation() {
     setRunning(true);
     initializeCLI();
@@ -30,99 +57,268 @@ void Model::initializeCLI() {
     cli->start();
 }
 
-void Model::registerAgent(Agent* agent) {
-    if (agent) {  // Check if agent is valid
-        long long int id = agent->getID();
-        agents[id] = std::unique_ptr<Agent>(agent);
-        if (agent->getCell()) {  // Check if cell is valid
-            agent->getCell()->addAgent(id);
+void Model::registerAgent(AgentStoreBase* store, const AgentRecord& record) {
+    // Ids are handed out here, in queue order, so they do not depend on which thread queued the agent
+    AgentRecord placed = record;
+    if (placed.id < 0) {
+        placed.id = getNextID();
+    }
+    AgentLocation location{ store, store->size() };
+    AgentHandle handle = agentIndex.insert(location);
+    store->add(placed, handle);
+    linkToCell(location, placed.cellIndex);
+    PROFILE_COUNT(profiler, store->getTypeId(), Births);
+}
+
+void Model::linkToCell(const AgentLocation& location, int cellIndex) {
+    if (Cell* cell = getCellByIndex(cellIndex)) {  // Check if cell is valid
+        AgentColumns& columns = location.store->getColumns();
+        columns.cellSlot[location.slot] = cell->addAgent(columns.handles[location.slot], location.store->getTypeId(), followCellSlot());
+    }
+}
+
+void Model::unlinkFromCell(const AgentLocation& location) {
+    AgentColumns& columns = location.store->getColumns();
+    Cell* cell = getCellByIndex(columns.cellIndex[location.slot]);
+    if (!cell) return;
+    cell->removeAgent(columns.cellSlot[location.slot], location.store->getTypeId(), followCellSlot());
+}
+
+void Model::removeAgent(AgentHandle agent) {
+    if (const AgentLocation* found = agentIndex.get(agent)) {
+        AgentLocation location = *found;
+        PROFILE_COUNT(profiler, location.store->getTypeId(), Deaths);
+        unlinkFromCell(location);
+        agentIndex.erase(agent);
+        // The store fills the hole with its last agent, whose slot has to follow
+        AgentHandle moved = location.store->remove(location.slot);
+        if (!moved.isNull()) {
+            agentIndex.get(moved)->slot = location.slot;
         }
     }
 }
 
-void Model::removeAgent(long long int agentId) {
-    auto it = agents.find(agentId);
-    if (it != agents.end()) {
-        if (it->second->getCell()) {  // Check if cell is valid
-            it->second->getCell()->removeAgent(agentId);
+void Model::placeAgent(AgentStoreBase* store, const AgentRecord& record, bool ghost) {
+    AgentColumns& columns = store->getColumns();
+    if (!ghost && columns.ghosts > 0) {
+        throw std::logic_error("owned agents must be placed before ghosts");
+    }
+    registerAgent(store, record);
+    if (ghost) {
+        columns.ghosts++;
+    }
+}
+
+void Model::clearGhosts() {
+    for (auto& store : stores) {
+        AgentColumns& columns = store->getColumns();
+        // Always the last slot, so nothing else moves
+        for (; columns.ghosts > 0; columns.ghosts--) {
+            removeAgent(columns.handles.back());
         }
-        agents.erase(it);
     }
 }
 
-void Model::queueAgentForAddition(std::unique_ptr<Agent> agent) {
-    std::scoped_lock lock(agentMutex);
-    agentsToAdd.push_back(std::move(agent));
+AgentStoreBase* Model::findStore(const std::string& type) const {
+    for (const auto& store : stores) {
+        if (store->getType() == type) {
+            return store.get();
+        }
+    }
+    return nullptr;
 }
 
-void Model::queueAgentForRemoval(long long int agentId) {
+void Model::queueAgentForRemoval(AgentHandle agent) {
+    if (IntentBuffer* intents = activeIntents) {
+        intents->deaths.push_back(agent);
+        return;
+    }
     std::scoped_lock lock(agentMutex);
-    agentsToRemove.push_back(agentId);
+    agentsToRemove.push_back(agent);
+}
+
+bool parseScheduler(const std::string& name, Scheduler& scheduler) {
+    if (name == "sequential") scheduler = Scheduler::Sequential;
+    else if (name == "shuffled") scheduler = Scheduler::Shuffled;
+    else if (name == "parallel") scheduler = Scheduler::Parallel;
+    else if (name == "domains") scheduler = Scheduler::Domains;
+    else return false;
+    return true;
 }
 
 void Model::processAgentQueues() {
-    // Process removals first
-    for (long long int agentId : agentsToRemove) {
-        removeAgent(agentId);
+    // Removals first. The same agent can be queued more than once (two birds taking one worm,
+    // or a worm dying in act() and again in ageAndDie()), so only live handles are kept and
+    // the rest are sorted by the cell they leave, which puts duplicates side by side.
+    pendingRemovals.clear();
+    for (AgentHandle agent : agentsToRemove) {
+        if (const AgentLocation* location = agentIndex.get(agent)) {
+            pendingRemovals.push_back({ location->store->getColumns().cellIndex[location->slot], agent });
+        }
+    }
+    std::sort(pendingRemovals.begin(), pendingRemovals.end(), [](const PendingRemoval& a, const PendingRemoval& b) {
+        if (a.cellIndex != b.cellIndex) return a.cellIndex < b.cellIndex;
+        if (a.agent.index != b.agent.index) return a.agent.index < b.agent.index;
+        return a.agent.generation < b.agent.generation;
+    });
+    pendingRemovals.erase(std::unique(pendingRemovals.begin(), pendingRemovals.end(), [](const PendingRemoval& a, const PendingRemoval& b) {
+        return a.agent == b.agent;
+    }), pendingRemovals.end());
+    for (const PendingRemoval& removal : pendingRemovals) {
+        removeAgent(removal.agent);
     }
+    queueStats.removed = pendingRemovals.size();
+    queueStats.duplicatesDropped = agentsToRemove.size() - pendingRemovals.size();
+    queueStats.totalDuplicatesDropped += queueStats.duplicatesDropped;
     agentsToRemove.clear();
 
-    // Process additions
-    for (auto& agent : agentsToAdd) {
-        if (agent) {  // Check if agent is still valid
-            registerAgent(agent.release());
+    // Births grouped by species, then by cell; the order is fixed by type id rather than
+    // store address so ids come out the same on every run
+    std::stable_sort(agentsToAdd.begin(), agentsToAdd.end(), [](const auto& a, const auto& b) {
+        if (a.first->getTypeId() != b.first->getTypeId()) return a.first->getTypeId() < b.first->getTypeId();
+        return a.second.cellIndex < b.second.cellIndex;
+    });
+    for (size_t begin = 0; begin < agentsToAdd.size();) {
+        AgentStoreBase* store = agentsToAdd[begin].first;
+        size_t end = begin;
+        while (end < agentsToAdd.size() && agentsToAdd[end].first == store) {
+            ++end;
         }
+        store->reserveFor(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            registerAgent(store, agentsToAdd[i].second);
+        }
+        begin = end;
     }
+    queueStats.added = agentsToAdd.size();
     agentsToAdd.clear();
 }
 
 void Model::loop()  
 {
+   Trace::setThreadName("simulation");
    while (simulationState.running) {  
+       if (checkpointRequested.exchange(false)) {
+           std::string path;
+           {
+               std::scoped_lock lock(checkpointMutex);
+               path = requestedCheckpoint;
+           }
+           writeCheckpoint(path);
+       }
        if (simulationState.stepOnce) {
            step();
-           std::cout << "[Model] Step: " << stepCount << std::endl;
+           std::cout << "[Model] Step: " << stepCount << '\n';
            simulationState.stepOnce = false;
        }
        // Handle queued steps
        while (simulationState.stepsToRun > 0) {
            step();
-           std::cout << "[Model] Step: " << stepCount << std::endl;
+           std::cout << "[Model] Step: " << stepCount << '\n';
            simulationState.stepsToRun--;
        }
        if (!simulationState.playing) {
            // Wait on cv until playing is true or steps are queued
+           TRACE_SCOPE("idle", "model");
            std::unique_lock lk(simulationState.m);
            simulationState.cv.wait(lk, [this]{
-               return simulationState.playing || simulationState.stepOnce || simulationState.stepsToRun > 0 || !simulationState.running;
+               return simulationState.playing || simulationState.stepOnce || simulationState.stepsToRun > 0
+                   || checkpointRequested || !simulationState.running;
            });
        }  
        else {  
            step();
-           std::cout << "[Model] Step: " << stepCount << std::endl;
+           std::cout << "[Model] Step: " << stepCount << '\n';
        }  
    }  
 }
 
 void Model::step() {
-    // Environmental Aspects
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            grid[i][j].updateEnvironment();
-        }
+    TRACE_SCOPE_ARG("step", "model", stepCount);
+    PROFILE_PHASE(profiler, Step);
+    if (stepStartHook) {
+        stepStartHook();
+    }
+    applyThreadCount();
+
+    // Environmental Aspects: cell-local, so tiles are spread over the pool
+    {
+        PROFILE_PHASE(profiler, Environment);
+        pool->parallelFor(static_cast<size_t>(tileRows()) * tileCols(), [this](size_t tile) {
+            updateEnvironmentTile(tile);
+        });
     }
     
-    // Agents Prepare/Act(Should be split up for multithreading)
-    for (auto& [id, agent] : agents) {
-        agent->prepare();
-        agent->act();
+    // Agents Prepare/Act
+    switch (scheduler.load()) {
+    case Scheduler::Parallel:
+        stepAgentsParallel();
+        break;
+    case Scheduler::Shuffled:
+        stepAgentsShuffled();
+        break;
+    case Scheduler::Domains:
+        stepAgentsDomains();
+        break;
+    default:
+        stepAgentsSequential();
+        break;
     }
 
+    // Ghost copies were only there to be observed during act
+    clearGhosts();
+
     // Then process any queued additions/removals
-    processAgentQueues();
+    {
+        PROFILE_PHASE(profiler, Queues);
+        processAgentQueues();
+    }
 
     // Increment step counter
     stepCount++;
+
+    if (timeSeries) {
+        timeSeries->record(*this);
+    }
+    unsigned every = checkpointEvery;
+    if (every > 0 && stepCount % every == 0) {
+        std::string path;
+        {
+            std::scoped_lock lock(checkpointMutex);
+            path = checkpointPath;
+        }
+        writeCheckpoint(path);
+    }
+    if (stepHook) {
+        stepHook();
+    }
+}
+
+void Model::updateEnvironmentTile(size_t tile) {
+    int rowBegin = std::max(ownedRowBegin, static_cast<int>(tile / tileCols()) * tileHeight);
+    int colBegin = static_cast<int>(tile % tileCols()) * tileWidth;
+    int rowEnd = std::min(ownedRowEnd, static_cast<int>(tile / tileCols()) * tileHeight + tileHeight);
+    int colEnd = std::min(width, colBegin + tileWidth);
+    WeatherTally tally{};
+    FieldTally totals;
+    for (int i = rowBegin; i < rowEnd; ++i) {
+        // Water and soil for the whole tile row at once, then the weather transitions
+        size_t begin = static_cast<size_t>(i) * width + colBegin;
+        size_t end = static_cast<size_t>(i) * width + colEnd;
+        totals.water += updateWaterAndSoilBatch(fields, *climate, begin, end, Cell::maxSoilSaturation);
+        for (size_t j = begin; j < end; ++j) {
+            grid[j].updateWeather(tally);
+        }
+    }
+    fields.mergeWeather(tally);
+    fields.mergeTotals(totals);
+}
+
+void Model::applyThreadCount() {
+    unsigned threads = requestedThreads;
+    if (!pool || pool->size() != threads) {
+        pool = std::make_unique<ThreadPool>(threads);
+    }
 }
 
 void Model::step(int x) {
@@ -138,29 +334,276 @@ void Model::queueSteps(int n) {
     wake();
 }
 
+void Model::requestCheckpoint(const std::string& path) {
+    {
+        std::scoped_lock lock(checkpointMutex);
+        requestedCheckpoint = path;
+    }
+    checkpointRequested = true;
+    wake();
+}
+
+void Model::setCheckpointSchedule(unsigned every, const std::string& path) {
+    std::scoped_lock lock(checkpointMutex);
+    checkpointPath = path;
+    checkpointEvery = every;
+}
+
+void Model::writeCheckpoint(const std::string& path) {
+    // A failed save must not end a long run; the previous checkpoint is still in place
+    try {
+        Checkpoint::save(*this, path);
+        std::cout << "[Model] Checkpoint at step " << stepCount << " written to " << path << '\n';
+    } catch (const std::exception& e) {
+        std::cerr << "[Model] Checkpoint to " << path << " failed: " << e.what() << '\n';
+    }
+}
+
+void Model::stepAgentsSequential() {
+    PROFILE_PHASE(profiler, Act);
+    // One species store at a time
+    for (auto& store : stores) {
+        store->stepAll();
+    }
+}
+
+void Model::stepAgentsParallel() {
+    chunks.clear();
+    for (auto& store : stores) {
+        for (size_t begin = 0; begin < store->activeSize(); begin += parallelChunkSize) {
+            chunks.push_back({ store.get(), begin, std::min(store->activeSize(), begin + parallelChunkSize) });
+        }
+    }
+    if (intentBuffers.size() < chunks.size()) {
+        intentBuffers.resize(chunks.size());
+    }
+
+    // prepare() only touches the agent's own columns
+    {
+        PROFILE_PHASE(profiler, Prepare);
+        pool->parallelFor(chunks.size(), [this](size_t c) {
+            chunks[c].store->prepareRange(chunks[c].begin, chunks[c].end);
+        });
+    }
+
+    PROFILE_PHASE(profiler, Act);
+    // act() sees the frozen view: other agents' energy and flags as they were after prepare,
+    // and cells, cell membership and positions as they were at the start of act
+    for (auto& store : stores) {
+        store->getColumns().freeze();
+    }
+    pool->parallelFor(chunks.size(), [this](size_t c) {
+        activeIntents = &intentBuffers[c];
+        chunks[c].store->actRange(chunks[c].begin, chunks[c].end);
+        activeIntents = nullptr;
+    });
+    for (auto& store : stores) {
+        store->getColumns().thaw();
+    }
+
+    preyClaimPass++;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        applyIntents(intentBuffers[c]);
+    }
+}
+
+void Model::applyDomainLayout() {
+    int rows = requestedDomainRows;
+    int cols = requestedDomainCols;
+    if (rows <= 0 || cols <= 0) {
+        rows = (height + defaultDomainSize - 1) / defaultDomainSize;
+        cols = (width + defaultDomainSize - 1) / defaultDomainSize;
+    }
+    rows = std::max(1, std::min(rows, height));
+    cols = std::max(1, std::min(cols, width));
+
+    int halo = 0;
+    for (auto& store : stores) {
+        halo = std::max(halo, store->getInteractionRange());
+    }
+
+    if (rows == domainRows && cols == domainCols && halo == haloWidth && subdomains.size() == static_cast<size_t>(rows * cols)) {
+        return;
+    }
+    domainRows = rows;
+    domainCols = cols;
+    haloWidth = halo;
+    subdomains.assign(static_cast<size_t>(rows) * cols, Subdomain{});
+    rowToDomainRow.resize(height);
+    colToDomainCol.resize(width);
+    for (int r = 0; r < rows; ++r) {
+        int begin = static_cast<int>(static_cast<long long>(r) * height / rows);
+        int end = static_cast<int>(static_cast<long long>(r + 1) * height / rows);
+        for (int x = begin; x < end; ++x) rowToDomainRow[x] = r;
+        for (int c = 0; c < cols; ++c) {
+            subdomains[r * cols + c].rowBegin = begin;
+            subdomains[r * cols + c].rowEnd = end;
+        }
+    }
+    for (int c = 0; c < cols; ++c) {
+        int begin = static_cast<int>(static_cast<long long>(c) * width / cols);
+        int end = static_cast<int>(static_cast<long long>(c + 1) * width / cols);
+        for (int y = begin; y < end; ++y) colToDomainCol[y] = c;
+        for (int r = 0; r < rows; ++r) {
+            subdomains[r * cols + c].colBegin = begin;
+            subdomains[r * cols + c].colEnd = end;
+        }
+    }
+}
+
+void Model::stepAgentsDomains() {
+    applyDomainLayout();
+
+    // Membership follows position, so agents that crossed a border last step now belong to their new subdomain
+    for (Subdomain& domain : subdomains) {
+        domain.slots.resize(stores.size());
+        for (auto& slots : domain.slots) {
+            slots.clear();
+        }
+    }
+    for (size_t s = 0; s < stores.size(); ++s) {
+        const std::vector<int>& cellIndex = stores[s]->getColumns().cellIndex;
+        for (size_t slot = 0; slot < stores[s]->activeSize(); ++slot) {
+            subdomains[domainOf(cellIndex[slot])].slots[s].push_back(slot);
+        }
+    }
+
+    {
+        PROFILE_PHASE(profiler, Prepare);
+        pool->parallelFor(subdomains.size(), [this](size_t d) {
+            for (size_t s = 0; s < stores.size(); ++s) {
+                stores[s]->prepareSlots(subdomains[d].slots[s]);
+            }
+        });
+    }
+
+    PROFILE_PHASE(profiler, Act);
+
+    for (auto& store : stores) {
+        store->getColumns().freeze();
+    }
+    pool->parallelFor(subdomains.size(), [this](size_t d) {
+        activeIntents = &subdomains[d].exchange;
+        activeDomain = &subdomains[d];
+        activeTally = &subdomains[d].tally;
+        for (size_t s = 0; s < stores.size(); ++s) {
+            stores[s]->actSlots(subdomains[d].slots[s]);
+        }
+        activeTally = nullptr;
+        activeDomain = nullptr;
+        activeIntents = nullptr;
+    });
+    for (auto& store : stores) {
+        store->getColumns().thaw();
+    }
+
+    // Halo exchange: everything that touched a band or crossed a border, in subdomain order
+    lastMigrations = 0;
+    preyClaimPass++;
+    for (size_t d = 0; d < subdomains.size(); ++d) {
+        fields.mergeTotals(subdomains[d].tally);
+        subdomains[d].tally = {};
+        for (const Intent& intent : subdomains[d].exchange.intents) {
+            if (intent.kind == Intent::Kind::Move && domainOf(intent.cellIndex) != static_cast<int>(d)) {
+                lastMigrations++;
+            }
+        }
+        applyIntents(subdomains[d].exchange);
+    }
+}
+
+void Model::applyIntents(IntentBuffer& buffer) {
+    for (const Intent& intent : buffer.intents) {
+        switch (intent.kind) {
+        case Intent::Kind::Move:
+            moveAgent(intent.agent, getCellByIndex(intent.cellIndex));
+            break;
+        case Intent::Kind::ModifyNutrients:
+            grid[intent.cellIndex].modifyNutrients(intent.amount);
+            break;
+        case Intent::Kind::ModifyWater:
+            grid[intent.cellIndex].modifyWater(intent.amount);
+            break;
+        case Intent::Kind::ModifySoilSaturation:
+            grid[intent.cellIndex].modifySoilSaturation(intent.amount);
+            break;
+        case Intent::Kind::Eat: {
+            const AgentLocation* eater = agentIndex.get(intent.agent);
+            if (!eater) break;
+            int eaten = std::min(intent.amount, grid[intent.cellIndex].getNutrients());
+            grid[intent.cellIndex].modifyNutrients(-eaten);
+            int& energy = eater->store->getColumns().energy[eater->slot];
+            energy = std::min(intent.limit, energy + eaten);
+            break;
+        }
+        case Intent::Kind::Prey: {
+            const AgentLocation* predator = agentIndex.get(intent.agent);
+            if (!predator || !agentIndex.get(intent.target)) break;
+            // Skip prey an earlier intent already claimed this step
+            if (!claimPrey(intent.target)) break;
+            int& energy = predator->store->getColumns().energy[predator->slot];
+            energy = std::min(intent.limit, energy + intent.amount);
+            agentsToRemove.push_back(intent.target);
+            break;
+        }
+        case Intent::Kind::TransferEnergy:
+            transferEnergy(intent.agent, intent.amount);
+            break;
+        }
+    }
+    {
+        std::scoped_lock lock(agentMutex);
+        for (const QueuedBirth& birth : buffer.births) {
+            agentsToAdd.emplace_back(birth.resolve(this), birth.record);
+        }
+        agentsToRemove.insert(agentsToRemove.end(), buffer.deaths.begin(), buffer.deaths.end());
+    }
+    buffer.clear();
+}
+
+bool Model::claimPrey(AgentHandle prey) {
+    if (preyClaims.size() < agentIndex.capacity()) {
+        preyClaims.resize(agentIndex.capacity(), 0);
+    }
+    if (preyClaims[prey.index] == preyClaimPass) {
+        return false;
+    }
+    preyClaims[prey.index] = preyClaimPass;
+    return true;
+}
+
 void Model::shuffle_step() {
+    stepAgentsShuffled();
+    processAgentQueues();
+    stepCount++;
+}
+
+void Model::stepAgentsShuffled() {
+    PROFILE_PHASE(profiler, Act);
     std::vector<Agent*> agentPtrs;
-    agentPtrs.reserve(agents.size());
-    for (auto& [id, agent] : agents) {
-        agentPtrs.push_back(agent.get());
+    agentPtrs.reserve(agentIndex.size());
+    for (auto& store : stores) {
+        for (size_t slot = 0; slot < store->activeSize(); ++slot) {
+            agentPtrs.push_back(store->view(slot));
+        }
     }
 
     std::shuffle(agentPtrs.begin(), agentPtrs.end(), rng);
 
     for (Agent* agent : agentPtrs) {
+        PROFILE_ACTING(agent->getTypeId());
         agent->prepare();
         agent->act();
     }
-
-    processAgentQueues();
-    stepCount++;
 }
 
 void Model::display() const {
+    TRACE_SCOPE("display", "output");
+    AgentTypeId tree = agentTypeId<Tree>();
     for (int i = 0; i < height; ++i) {
         for (int j = 0; j < width; ++j) {
-            const Cell& cell = grid[i][j];
-            if (cell.hasType("Tree")) {
+            const Cell& cell = grid[i * width + j];
+            if (cell.hasType(tree)) {
                 std::cout << "T ";
             }
             else {
@@ -171,61 +614,123 @@ void Model::display() const {
     }
 }
 
-void Model::collectMetrics() const {
-    // Accumulate weather states
-    std::unordered_map<weatherState, int> weatherCounts;
-    for (const auto& row : grid) {
-        for (const auto& cell : row) {
-            weatherState weather = cell.getWeather(); // Assuming getWeatherState() returns a string
-            weatherCounts[weather]++;
-        }
+ModelMetrics Model::getMetrics() const {
+    ModelMetrics metrics;
+    for (int state = 0; state < weatherStateCount; ++state) {
+        metrics.weather[state] = fields.weatherCounts[state].load(std::memory_order_relaxed);
     }
-
-    // Accumulate agent types
-    std::unordered_map<std::string, int> agentCounts;
-    for (const auto& [id, agent] : agents) {
-        std::string type = agent->getType();
-        agentCounts[type]++;
+    metrics.water = fields.waterTotal.load(std::memory_order_relaxed);
+    metrics.nutrients = fields.nutrientTotal.load(std::memory_order_relaxed);
+    metrics.agents.reserve(stores.size());
+    for (const auto& store : stores) {
+        metrics.agents.emplace_back(store->getTypeId(), store->activeSize());
     }
+    return metrics;
+}
+
+void Model::collectMetrics() const {
+    TRACE_SCOPE("metrics", "output");
+    ModelMetrics metrics = getMetrics();
 
     // Print metrics
     std::cout << "\n--- Metrics ---\n";
     std::cout << "Weather States:\n";
-    for (const auto& [weather, count] : weatherCounts) {
-        std::cout << "  " << weather << ": " << count << "\n";
+    for (int state = 0; state < weatherStateCount; ++state) {
+        if (metrics.weather[state] > 0) {
+            std::cout << "  " << state << ": " << metrics.weather[state] << "\n";
+        }
     }
 
     std::cout << "Agent Types:\n";
-    for (const auto& [type, count] : agentCounts) {
-        std::cout << "  " << type << ": " << count << "\n";
+    for (const auto& [type, count] : metrics.agents) {
+        std::cout << "  " << AgentTypes::name(type) << ": " << count << "\n";
     }
     std::cout << "----------------\n";
 }
 
-Agent* Model::getAgent(long long int agentId) {
-    auto it = agents.find(agentId);
-    if (it != agents.end()) {
-        return it->second.get();
+void Model::printPoolStats() const {
+    TRACE_SCOPE("pools", "output");
+    std::cout << "\n--- Agent Pools ---\n";
+    for (const auto& store : stores) {
+        const AgentColumns& columns = store->getColumns();
+        std::cout << "  " << store->getType() << ": " << columns.activeSize() << " live / "
+            << columns.capacity() << " slots, peak " << columns.peak
+            << ", grown " << columns.growths << "x, "
+            << columns.acquired << " acquired, " << columns.released << " released\n";
+    }
+    std::cout << "  Last commit: " << queueStats.removed << " removed, " << queueStats.added << " added, "
+        << queueStats.duplicatesDropped << " duplicate removals dropped ("
+        << queueStats.totalDuplicatesDropped << " in total)\n";
+    std::cout << "-------------------\n";
+}
+
+void Model::printProfile() const {
+#if NHAGW_PROFILE
+    profiler.print(std::cout);
+#else
+    std::cout << "Profiling is compiled out; rebuild with -DNHAGW_PROFILE=1\n";
+#endif
+}
+
+void Model::resetProfile() {
+#if NHAGW_PROFILE
+    profiler.reset();
+#endif
+}
+
+Agent* Model::getAgent(AgentHandle agent) {
+    PROFILE_COUNT_ACTING(profiler, Lookups);
+    if (const AgentLocation* location = agentIndex.get(agent)) {
+        return location->store->view(location->slot);
     }
     return nullptr;
 }
 
-void Model::moveAgent(long long int agentId, Cell* newCell)
+void Model::moveAgent(AgentHandle handle, Cell* newCell)
 {
-    auto it = agents.find(agentId);
-    if (it != agents.end()) {
-        Agent* agent = it->second.get();
+    PROFILE_COUNT_ACTING(profiler, Lookups);
+    if (const AgentLocation* location = agentIndex.get(handle)) {
+        Agent* agent = location->store->view(location->slot);
         Cell* oldCell = agent->getCell();
-        if (oldCell) {
-            oldCell->removeAgent(agentId);
+        // Both ends of the move have to be safe to touch directly
+        IntentBuffer* intents = deferredIntents(newCell->getIndex());
+        if (!intents && oldCell) {
+            intents = deferredIntents(oldCell->getIndex());
+        }
+        if (intents) {
+            intents->move(handle, newCell->getIndex());
+            return;
         }
-        newCell->addAgent(agentId);
+        PROFILE_COUNT(profiler, location->store->getTypeId(), Moves);
+        unlinkFromCell(*location);
         agent->setCell(newCell);
+        linkToCell(*location, newCell->getIndex());
+    }
+}
+
+void Model::transferEnergy(AgentHandle agent, int amount) {
+    PROFILE_COUNT_ACTING(profiler, Lookups);
+    if (const AgentLocation* location = agentIndex.get(agent)) {
+        AgentColumns& columns = location->store->getColumns();
+        if (IntentBuffer* intents = deferredIntents(columns.cellIndex[location->slot])) {
+            intents->transferEnergy(agent, amount);
+            return;
+        }
+        columns.energy[location->slot] += amount;
     }
 }
 
 std::mt19937& Model::getRNG() { return rng; }
-long long int Model::getNextID() { return counter++; }
+long long int Model::getNextID() { return counter++ * idStride + idOffset; }
+
+void Model::setIdStride(int offset, int stride) {
+    // First counter value whose ids lie past everything numbered so far
+    long long int next = counter * idStride + idOffset;
+    idStride = stride;
+    idOffset = offset;
+    counter = (next - offset + stride - 1) / stride;
+    if (counter < 0) counter = 0;
+}
 
 Cell* Model::getCell(int x, int y) {
     if (torus) {
@@ -233,16 +738,16 @@ Cell* Model::getCell(int x, int y) {
         y = (y + width) % width;
     }
     if (x >= 0 && x < height && y >= 0 && y < width) {
-        return &grid[x][y];
+        return &grid[x * width + y];
     }
     return nullptr;
 }
 
-void Model::registerAgentType(Agent* prototype) {
-    if (!isAgentTypeInitialized(prototype->getType())) {
-        prototype->initializeType();
-        initializedTypes[prototype->getType()] = true;
+Cell* Model::getCellByIndex(int index) {
+    if (index < 0 || index >= height * width) {
+        return nullptr;
     }
+    return &grid[index];
 }
 
 bool Model::isAgentTypeInitialized(const std::string& type) const {
@@ -8,11 +8,30 @@
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <functional>
 #include "Cell.h"
 #include "Agent.h"
+#include "AgentStore.h"
 #include "Climate.h"
+#include "CounterRNG.h"
+#include "ThreadPool.h"
+#include "Intent.h"
+#include "Stencil.h"
+#include "Profiler.h"
 
 class CLI;  // Forward declaration
+class TimeSeriesWriter;
+
+// How step() runs the agents
+enum class Scheduler {
+    Sequential,  // prepare() then act() per agent, species by species
+    Shuffled,    // as Sequential, in a random order across all agents
+    Parallel,    // prepare() in parallel, then act() in parallel with effects buffered as intents
+    Domains      // the torus is cut into rectangular subdomains, each stepped by one task
+};
+
+// Reads sequential|shuffled|parallel|domains into scheduler; false (scheduler untouched) otherwise
+bool parseScheduler(const std::string& name, Scheduler& scheduler);
 
 struct SimulationState {
     std::atomic<bool> running{ false };
@@ -24,28 +43,181 @@ struct SimulationState {
     std::atomic<bool> playing{ false };
 };
 
+// What the last processAgentQueues() committed, plus the running count of dropped removals
+struct QueueStats {
+    size_t removed = 0;
+    size_t added = 0;
+    // Removal requests for an agent already removed, or queued more than once in the step
+    size_t duplicatesDropped = 0;
+    unsigned long long totalDuplicatesDropped = 0;
+};
+
+// Weather and population totals, read from running counters in time proportional to the
+// number of weather states and species rather than to the grid or the population
+struct ModelMetrics {
+    std::array<long long, weatherStateCount> weather{};
+    long long water = 0;
+    long long nutrients = 0;
+    // One entry per species store, in store order; ghosts are not counted
+    std::vector<std::pair<AgentTypeId, size_t>> agents;
+};
+
 class Model {
+    // Reads and rebuilds the private state directly (see Checkpoint.h)
+    friend class Checkpoint;
+
 private:
     int height;
     int width;
     bool torus;
-    std::vector<std::vector<Cell>> grid;
-    std::unordered_map<long long int, std::unique_ptr<Agent>> agents;
-    std::vector<std::unique_ptr<Agent>> agentsToAdd;
-    std::vector<long long int> agentsToRemove;
+    // Row-major cell views over the dense per-field arrays in fields
+    std::vector<Cell> grid;
+    GridFields fields;
+
+    // Where an agent's state lives: its species store and slot within that store
+    struct AgentLocation {
+        AgentStoreBase* store;
+        size_t slot;
+    };
+    // One columnar store per species, walked in creation order by step()
+    std::vector<std::unique_ptr<AgentStoreBase>> stores;
+    // Indexed by AgentTypeId; null for types this model has no store for
+    std::vector<AgentStoreBase*> storesByType = std::vector<AgentStoreBase*>(AgentTypes::maxTypes, nullptr);
+    // Handle -> location of every live agent, ghosts included
+    SlotMap<AgentLocation> agentIndex;
+    std::vector<std::pair<AgentStoreBase*, AgentRecord>> agentsToAdd;
+    std::vector<AgentHandle> agentsToRemove;
+    // Scratch for processAgentQueues: live removals keyed by the cell they leave
+    struct PendingRemoval {
+        int cellIndex;
+        AgentHandle agent;
+    };
+    std::vector<PendingRemoval> pendingRemovals;
+    QueueStats queueStats;
     std::unique_ptr<CLI> cli;
     std::mt19937 rng;
+    uint32_t seed;
     long long int counter = 0;
+    // Ids are counter * idStride + idOffset, so processes sharing a distributed run never collide
+    long long int idStride = 1;
+    long long int idOffset = 0;
     unsigned long long stepCount = 0;
     std::unordered_map<std::string, bool> initializedTypes;
 
     // Threading support
     SimulationState simulationState;
     std::mutex agentMutex;  // for safely modifying agentsToAdd/agentsToRemove
+    std::unique_ptr<ThreadPool> pool;
+    std::atomic<unsigned> requestedThreads{ 1 };  // applied at the start of the next step
+
+    // Environment tiles: tileHeight rows by tileWidth columns, row-major over the grid
+    static constexpr int tileHeight = 64;
+    static constexpr int tileWidth = 512;
+    int tileRows() const { return (height + tileHeight - 1) / tileHeight; }
+    int tileCols() const { return (width + tileWidth - 1) / tileWidth; }
+    void updateEnvironmentTile(size_t tile);
+    void applyThreadCount();
+
+    // Rows whose environment this process steps; the whole grid unless it is one rank of a distributed run
+    int ownedRowBegin = 0;
+    int ownedRowEnd = 0;
+    std::function<void()> stepStartHook;
+    std::function<void()> stepHook;
+    TimeSeriesWriter* timeSeries = nullptr;
+
+    // Checkpoints are only written on the simulation thread between steps: a requested one
+    // before the loop's next step, a scheduled one at the end of every checkpointEvery-th step
+    std::mutex checkpointMutex;  // guards the two paths
+    std::string requestedCheckpoint;
+    std::atomic<bool> checkpointRequested{ false };
+    std::string checkpointPath;
+    std::atomic<unsigned> checkpointEvery{ 0 };
+    void writeCheckpoint(const std::string& path);
+
+    // Parallel scheduler: agents are cut into fixed-size chunks per store, each with its own
+    // intent buffer. The chunking does not depend on the thread count, and buffers are applied
+    // in chunk order, so results are identical for any number of threads.
+    static constexpr size_t parallelChunkSize = 2048;
+    struct AgentChunk {
+        AgentStoreBase* store;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<AgentChunk> chunks;
+    std::vector<IntentBuffer> intentBuffers;
+    // Prey claimed in the current apply pass: preyClaims[handle index] == preyClaimPass
+    std::vector<unsigned long long> preyClaims;
+    unsigned long long preyClaimPass = 0;
+    bool claimPrey(AgentHandle prey);
+    std::atomic<Scheduler> scheduler{ Scheduler::Sequential };
+
+    // Domain decomposition. Each subdomain steps its own agents on one task. Effects on its
+    // interior apply directly; effects on its halo band (the cells within haloWidth of its
+    // edge) or on other subdomains are deferred and applied at the exchange after act, in
+    // subdomain order. Other subdomains only ever read as far as the band, so nothing they
+    // read changes during act. An agent migrates when a deferred move crosses a border.
+    struct Subdomain {
+        int rowBegin, rowEnd, colBegin, colEnd;
+        std::vector<std::vector<size_t>> slots;  // member slots per store, rebuilt every step
+        IntentBuffer exchange;
+        FieldTally tally;  // water and nutrient change from direct writes, merged after act
+    };
+    std::vector<Subdomain> subdomains;
+    std::vector<int> rowToDomainRow;
+    std::vector<int> colToDomainCol;
+    int domainRows = 0;
+    int domainCols = 0;
+    int haloWidth = 0;
+    // Side of the default subdomains. Fixed rather than derived from the thread count, because
+    // the layout decides which effects are deferred and so the results.
+    static constexpr int defaultDomainSize = 128;
+    std::atomic<int> requestedDomainRows{ 0 };  // 0 cuts the grid into defaultDomainSize squares
+    std::atomic<int> requestedDomainCols{ 0 };
+    size_t lastMigrations = 0;
+    void applyDomainLayout();
+    void stepAgentsDomains();
+    int domainOf(int cellIndex) const {
+        return rowToDomainRow[cellIndex / width] * domainCols + colToDomainCol[cellIndex % width];
+    }
+    bool isInterior(const Subdomain& domain, int cellIndex) const {
+        int x = cellIndex / width;
+        int y = cellIndex % width;
+        return x - domain.rowBegin >= haloWidth && domain.rowEnd - 1 - x >= haloWidth
+            && y - domain.colBegin >= haloWidth && domain.colEnd - 1 - y >= haloWidth;
+    }
+
+    // Buffer the current thread is emitting into, or null when effects apply directly
+    static thread_local IntentBuffer* activeIntents;
+    // Subdomain the current thread is stepping, in the Domains scheduler
+    static thread_local const Subdomain* activeDomain;
+    // Tally direct cell writes add to, while the Domains scheduler steps subdomains concurrently
+    static thread_local FieldTally* activeTally;
+    void stepAgentsSequential();
+    void stepAgentsShuffled();
+    void stepAgentsParallel();
+    void applyIntents(IntentBuffer& buffer);
+    template <class T> static AgentStoreBase* resolveStore(Model* model) { return model->findOrCreateStore<T>(); }
     
-    void registerAgent(Agent* agent);
-    void removeAgent(long long int agentId);
-    Climate climate;
+    void registerAgent(AgentStoreBase* store, const AgentRecord& record);
+    void removeAgent(AgentHandle agent);
+    void clearGhosts();
+    // Cell membership of the agent at location, with the back-indices in its columns kept current
+    void linkToCell(const AgentLocation& location, int cellIndex);
+    void unlinkFromCell(const AgentLocation& location);
+    // Callback for Cell::addAgent/removeAgent: records where a shifted agent now sits
+    auto followCellSlot() {
+        return [this](AgentHandle moved, uint32_t position) {
+            if (const AgentLocation* location = agentIndex.get(moved)) {
+                location->store->getColumns().cellSlot[location->slot] = position;
+            }
+        };
+    }
+    template <class T> AgentStore<T>* findOrCreateStore();
+    // Compiled tables, read-only once set, so many models (an ensemble) can share one
+    std::shared_ptr<const Climate> climate;
+#if NHAGW_PROFILE
+    Profiler profiler;
+#endif
 
 public:
     Model(int h, int w, bool t, uint16_t s);
@@ -53,13 +225,60 @@ public:
     ~Model();
 
     // Agent utility functions
-    void registerAgentType(Agent* prototype);
+    // Creates the species' store and interns its type id; returns the id
+    template <class T> AgentTypeId registerAgentType();
+    AgentStoreBase* getStore(AgentTypeId type) const { return storesByType[type]; }
     bool isAgentTypeInitialized(const std::string& type) const;
-    void queueAgentForAddition(std::unique_ptr<Agent> agent);
-    void queueAgentForRemoval(long long int agentId);
+    template <class T> void queueAgentForAddition(const AgentRecord& record);
+    // Grows species T's slot pool to hold n agents without reallocating
+    template <class T> void reserveAgents(size_t n);
+    void queueAgentForRemoval(AgentHandle agent);
+    // Commits the step's removals and births in batches: removals are deduplicated and applied
+    // cell by cell, births grouped by species and cell with one pool reservation per species
     void processAgentQueues();
-    Agent* getAgent(long long int agentId);
-    void moveAgent(long long int agentId, Cell* newCell);
+    const QueueStats& getQueueStats() const { return queueStats; }
+    // The agent a handle refers to, or null once it has been removed
+    Agent* getAgent(AgentHandle agent);
+
+    // Calls visit(Cell&) for every cell within Manhattan distance radius of center, following
+    // Stencil::diamond(radius), until it returns false. Off-grid cells are skipped and on a
+    // torus offsets wrap. Nothing is allocated.
+    template <class Visit>
+    void forEachCellWithin(const Cell& center, int radius, Visit&& visit, bool includeCenter = false);
+
+    // Range queries over the per-type cell buckets, visiting cells as forEachCellWithin does
+    // (the centre included by default) and agents within a cell in bucket order.
+    // Nothing is allocated. visit must not add, remove or move agents of type T.
+    //
+    // Calls visit(T&) for each agent of species T in range until it returns false
+    template <class T, class Visit>
+    void forEachWithin(const Cell& center, int radius, Visit&& visit, bool includeCenter = true);
+    // First agent of species T in range for which match(const T&) holds, or null
+    template <class T, class Match>
+    T* findFirstWithin(const Cell& center, int radius, Match&& match, bool includeCenter = true);
+    template <class T, class Match>
+    size_t countWithin(const Cell& center, int radius, Match&& match, bool includeCenter = true);
+    size_t getAgentCount() const { return agentIndex.size(); }
+    void moveAgent(AgentHandle agent, Cell* newCell);
+    void transferEnergy(AgentHandle agent, int amount);
+    // Where an effect on cellIndex (or on no cell, -1) must be recorded during a parallel act
+    // phase; null when it may be applied directly
+    IntentBuffer* deferredIntents(int cellIndex = -1) const {
+        if (activeIntents && activeDomain && cellIndex >= 0 && isInterior(*activeDomain, cellIndex)) {
+            return nullptr;
+        }
+        return activeIntents;
+    }
+    // Adds the change a direct write made to the water and nutrient totals
+    void tallyFields(const FieldTally& change) {
+        if (activeTally) {
+            activeTally->water += change.water;
+            activeTally->nutrients += change.nutrients;
+        }
+        else {
+            fields.mergeTotals(change);
+        }
+    }
 
     // Update Simulation
     void loop();
@@ -71,18 +290,56 @@ public:
     // Update UI and render graphics
     void initializeCLI();
     void display() const;
+    ModelMetrics getMetrics() const;
+    // Prints getMetrics()
     void collectMetrics() const;
+    // Slot pool occupancy and growth per species, and the last queue commit
+    void printPoolStats() const;
+    // Rolling step phase timings and per-species counters; a note if profiling is compiled out
+    void printProfile() const;
+    void resetProfile();
+#if NHAGW_PROFILE
+    Profiler& getProfiler() { return profiler; }
+#endif
 
+    // Sequential generator for setup and shuffle_step; per-step simulation draws use the streams below
     std::mt19937& getRNG();
+    // Counter-based streams keyed by (seed, stepCount, entity, purpose), independent of thread count and order
+    RandomStream cellStream(int cellIndex, RandomPurpose purpose) const {
+        return RandomStream(seed, stepCount, RandomDomain::Cell, static_cast<uint64_t>(cellIndex), purpose);
+    }
+    RandomStream agentStream(long long int agentId, RandomPurpose purpose) const {
+        return RandomStream(seed, stepCount, RandomDomain::Agent, static_cast<uint64_t>(agentId), purpose);
+    }
     long long int getNextID();
     Cell* getCell(int x, int y);
+    Cell* getCellByIndex(int index);
+    GridFields& getFields() { return fields; }
+    const GridFields& getFields() const { return fields; }
     unsigned long long getStepCount() const { return stepCount; }
     bool isTorus() const { return torus; }
     int getWidth() const { return width; }
     int getHeight() const { return height; }
-    const Climate& getClimate() const { return climate; }
-    void setClimate(const Climate& newClimate) { climate = newClimate; }
+    const Climate& getClimate() const { return *climate; }
+    // Takes a compiled copy of newClimate
+    void setClimate(const Climate& newClimate);
+    // Shares an already compiled climate, which must not change while any model uses it
+    void setClimate(std::shared_ptr<const Climate> shared) { climate = std::move(shared); }
     void setPlaying(bool play) { simulationState.playing = play; }
+    void setScheduler(Scheduler s) { scheduler = s; }
+    Scheduler getScheduler() const { return scheduler; }
+    // Subdomain layout for the Domains scheduler; 0 x 0 uses defaultDomainSize squares, so results
+    // are the same for any thread count
+    void setDomainGrid(int rows, int cols) { requestedDomainRows = rows; requestedDomainCols = cols; }
+    int getDomainCount() const { return static_cast<int>(subdomains.size()); }
+    int getHaloWidth() const { return haloWidth; }
+    // Agents that crossed into another subdomain during the last Domains step
+    size_t getLastMigrations() const { return lastMigrations; }
+    // Number of threads used by step(), including the model thread; takes effect on the next step
+    void setThreadCount(unsigned n) { requestedThreads = n > 0 ? n : 1; }
+    // The last count set, which step() uses from its next start. Safe from any thread: the pool
+    // itself belongs to the simulation thread, which may replace it at any step.
+    unsigned getThreadCount() const { return requestedThreads; }
     void setRunning(bool run) {
         simulationState.running = run; 
         if (!run) {
@@ -96,4 +353,123 @@ public:
         std::unique_lock<std::mutex> lock(simulationState.m);
         simulationState.cv.notify_all();
     };
+
+    // Distributed runs (see Distributed.h)
+    void setOwnedRows(int begin, int end) { ownedRowBegin = begin; ownedRowEnd = end; }
+    bool ownsRow(int x) const { return x >= ownedRowBegin && x < ownedRowEnd; }
+    // Continues numbering so that every id handed out from now on is offset modulo stride
+    void setIdStride(int offset, int stride);
+    // Runs at the start of every step(), before anything is stepped
+    void setStepStartHook(std::function<void()> hook) { stepStartHook = std::move(hook); }
+    // Runs at the end of every step(), after the agent queues are processed
+    void setStepHook(std::function<void()> hook) { stepHook = std::move(hook); }
+    // Hands every step's statistics to writer, which must outlive its use here; null detaches
+    void setTimeSeries(TimeSeriesWriter* writer) { timeSeries = writer; }
+    // Asks the simulation loop to save a checkpoint to path before its next step, paused or not
+    void requestCheckpoint(const std::string& path);
+    // Saves a checkpoint to path after every every-th step; 0 stops. Failures are reported, not thrown.
+    void setCheckpointSchedule(unsigned every, const std::string& path);
+    const std::vector<std::unique_ptr<AgentStoreBase>>& getStores() const { return stores; }
+    AgentStoreBase* findStore(const std::string& type) const;
+    // Places an agent right away, keeping its id. Ghosts go after every owned agent of the
+    // store and are dropped again before the next step's queues are processed. They are
+    // read-only: prey and mate searches skip them, so no effect is ever aimed at one.
+    void placeAgent(AgentStoreBase* store, const AgentRecord& record, bool ghost = false);
+    void evictAgent(AgentHandle agent) { removeAgent(agent); }
 };
+
+// Must be called with agentMutex held
+template <class T>
+AgentStore<T>* Model::findOrCreateStore() {
+    AgentTypeId id = agentTypeId<T>();
+    if (AgentStoreBase* existing = storesByType[id]) {
+        return static_cast<AgentStore<T>*>(existing);
+    }
+    auto store = std::make_unique<AgentStore<T>>(this);
+    AgentStore<T>* raw = store.get();
+    stores.push_back(std::move(store));
+    storesByType[id] = raw;
+    if (!isAgentTypeInitialized(T::typeName)) {
+        T::initializeType();
+        initializedTypes[T::typeName] = true;
+    }
+    return raw;
+}
+
+template <class T>
+AgentTypeId Model::registerAgentType() {
+    std::scoped_lock lock(agentMutex);
+    return findOrCreateStore<T>()->getTypeId();
+}
+
+template <class T>
+void Model::reserveAgents(size_t n) {
+    std::scoped_lock lock(agentMutex);
+    findOrCreateStore<T>()->reserve(n);
+    agentIndex.reserve(agentIndex.size() + n);
+}
+
+template <class T>
+void Model::queueAgentForAddition(const AgentRecord& record) {
+    if (IntentBuffer* intents = activeIntents) {
+        intents->births.push_back({ &Model::resolveStore<T>, record });
+        return;
+    }
+    std::scoped_lock lock(agentMutex);
+    agentsToAdd.emplace_back(findOrCreateStore<T>(), record);
+}
+
+template <class Visit>
+void Model::forEachCellWithin(const Cell& center, int radius, Visit&& visit, bool includeCenter) {
+    PROFILE_COUNT_ACTING(profiler, NeighborQueries);
+    int x = center.getX();
+    int y = center.getY();
+    for (const CellOffset& offset : Stencil::diamond(radius)) {
+        if (offset.dx == 0 && offset.dy == 0 && !includeCenter) continue;
+        Cell* cell = getCell(x + offset.dx, y + offset.dy);
+        if (cell && !visit(*cell)) {
+            return;
+        }
+    }
+}
+
+template <class T, class Visit>
+void Model::forEachWithin(const Cell& center, int radius, Visit&& visit, bool includeCenter) {
+    AgentTypeId type = agentTypeId<T>();
+    bool stopped = false;
+    forEachCellWithin(center, radius, [&](Cell& cell) {
+        for (AgentHandle agent : fields.bucket(cell.getIndex(), type)) {
+            // Everything in a type's bucket is a view of that species
+            if (!visit(*static_cast<T*>(getAgent(agent)))) {
+                stopped = true;
+                break;
+            }
+        }
+        return !stopped;
+    }, includeCenter);
+}
+
+template <class T, class Match>
+T* Model::findFirstWithin(const Cell& center, int radius, Match&& match, bool includeCenter) {
+    T* found = nullptr;
+    forEachWithin<T>(center, radius, [&](T& agent) {
+        if (match(static_cast<const T&>(agent))) {
+            found = &agent;
+            return false;
+        }
+        return true;
+    }, includeCenter);
+    return found;
+}
+
+template <class T, class Match>
+size_t Model::countWithin(const Cell& center, int radius, Match&& match, bool includeCenter) {
+    size_t count = 0;
+    forEachWithin<T>(center, radius, [&](T& agent) {
+        if (match(static_cast<const T&>(agent))) {
+            count++;
+        }
+        return true;
+    }, includeCenter);
+    return count;
+}
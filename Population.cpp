@@ -0,0 +1,57 @@
+#include "Population.h"
+#include <random>
+#include "Model.h"
+#include "Tree.h"
+#include "Worm.h"
+#include "Bird.h"
+
+void populate(Model& model, int n_trees, int n_worms, int n_birds) {
+    int height = model.getHeight();
+    int width = model.getWidth();
+
+    // Fix the store order and type ids before any agent is queued, and size each pool for its initial population
+    model.registerAgentType<Tree>();
+    model.registerAgentType<Worm>();
+    model.registerAgentType<Bird>();
+    model.reserveAgents<Tree>(n_trees);
+    model.reserveAgents<Worm>(n_worms);
+    model.reserveAgents<Bird>(n_birds);
+
+    // Place trees randomly
+    std::uniform_int_distribution<int> dist_h(0, height - 1);
+    std::uniform_int_distribution<int> dist_w(0, width - 1);
+    
+    // Place trees
+    for (int i = 0; i < n_trees; ++i) {
+        int r = dist_h(model.getRNG());
+        int c = dist_w(model.getRNG());
+        Cell* cell = model.getCell(r, c);
+        if (cell) {
+            model.queueAgentForAddition<Tree>(Tree::create(cell));
+        }
+    }
+
+    // Place worms randomly
+    for (int i = 0; i < n_worms; ++i) {
+        int r = dist_h(model.getRNG());
+        int c = dist_w(model.getRNG());
+        Cell* cell = model.getCell(r, c);
+        if (cell) {
+            model.queueAgentForAddition<Worm>(Worm::create(cell));
+        }
+    }
+
+    // Place birds randomly
+    for (int i = 0; i < n_birds; ++i) {
+        int r = dist_h(model.getRNG());
+        int c = dist_w(model.getRNG());
+        Cell* cell = model.getCell(r, c);
+        if (cell) {
+            Bird::Gender gender = (model.getRNG()() % 2 < 1) ? Bird::Gender::Male : Bird::Gender::Female;
+            model.queueAgentForAddition<Bird>(Bird::create(cell, gender));
+        }
+    }
+
+    // Process all queued agents
+    model.processAgentQueues();
+}
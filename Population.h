@@ -0,0 +1,7 @@
+#pragma once
+
+class Model;
+
+// Registers the Tree, Worm and Bird stores in that order, then places the given numbers of
+// each on uniformly random cells using the model's setup generator
+void populate(Model& model, int n_trees, int n_worms, int n_birds);
@@ -0,0 +1,137 @@
+#include "Profiler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <vector>
+#include <iomanip>
+
+thread_local AgentTypeId Profiler::actingType = Profiler::noSpecies;
+std::atomic<uint64_t> Profiler::nextId{ 1 };
+thread_local uint64_t Profiler::cachedId = 0;
+thread_local Profiler::CounterRows* Profiler::cachedRows = nullptr;
+
+namespace {
+
+const char* counterNames[profileCounterCount] = { "Queries", "Lookups", "Births", "Deaths", "Moves" };
+
+// Nearest-rank percentile of sorted, which is not empty
+double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+}
+
+void Profiler::record(ProfilePhase phase, std::chrono::steady_clock::time_point start) {
+    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+    size_t p = static_cast<size_t>(phase);
+    // Whole steps are traced by Model::step itself, with the step number
+    if (phase != ProfilePhase::Step && Trace::enabled()) {
+        TraceEvent event;
+        event.name = profilePhaseName(phase);
+        event.category = "phase";
+        event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        event.begin = Trace::now() - event.duration;
+        Trace::record(event);
+    }
+    std::scoped_lock lock(sampleMutex);
+    samples[p][nextSample[p]] = std::chrono::duration<double, std::milli>(elapsed).count();
+    nextSample[p] = (nextSample[p] + 1) % window;
+    sampleCount[p] = std::min(sampleCount[p] + 1, window);
+}
+
+Profiler::CounterRows& Profiler::attachThread() {
+    std::thread::id self = std::this_thread::get_id();
+    std::scoped_lock lock(counterMutex);
+    auto found = std::find_if(threadRows.begin(), threadRows.end(),
+                              [&](const std::unique_ptr<ThreadCounters>& entry) { return entry->thread == self; });
+    if (found == threadRows.end()) {
+        threadRows.push_back(std::make_unique<ThreadCounters>());
+        threadRows.back()->thread = self;
+        found = threadRows.end() - 1;
+    }
+    cachedId = id;
+    cachedRows = &(*found)->rows;
+    return *cachedRows;
+}
+
+Profiler::CounterTotals Profiler::totals() const {
+    CounterTotals sum{};
+    std::scoped_lock lock(counterMutex);
+    for (const auto& entry : threadRows) {
+        for (size_t type = 0; type < sum.size(); ++type) {
+            for (size_t c = 0; c < profileCounterCount; ++c) {
+                sum[type][c] += entry->rows[type][c].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return sum;
+}
+
+void Profiler::reset() {
+    {
+        std::scoped_lock lock(sampleMutex);
+        sampleCount.fill(0);
+        nextSample.fill(0);
+    }
+    CounterTotals sum = totals();
+    std::scoped_lock lock(counterMutex);
+    baseline = sum;
+}
+
+void Profiler::print(std::ostream& out) const {
+    std::array<std::vector<double>, profilePhaseCount> sorted;
+    {
+        std::scoped_lock lock(sampleMutex);
+        for (size_t p = 0; p < profilePhaseCount; ++p) {
+            sorted[p].assign(samples[p].begin(), samples[p].begin() + sampleCount[p]);
+        }
+    }
+    size_t steps = sorted[static_cast<size_t>(ProfilePhase::Step)].size();
+
+    out << "\n--- Profile (last " << steps << " steps, ms) ---\n";
+    out << std::fixed << std::setprecision(3);
+    out << "  " << std::left << std::setw(12) << "Phase" << std::right
+        << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+    for (size_t p = 0; p < profilePhaseCount; ++p) {
+        std::vector<double>& values = sorted[p];
+        out << "  " << std::left << std::setw(12) << profilePhaseName(static_cast<ProfilePhase>(p)) << std::right;
+        if (values.empty()) {
+            out << std::setw(10) << "-" << "\n";
+            continue;
+        }
+        std::sort(values.begin(), values.end());
+        out << std::setw(10) << percentile(values, 0.5) << std::setw(10) << percentile(values, 0.9)
+            << std::setw(10) << percentile(values, 0.99) << std::setw(10) << values.back() << "\n";
+    }
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+
+    out << "  Counters since reset:\n";
+    out << "  " << std::left << std::setw(12) << "Species" << std::right;
+    for (const char* name : counterNames) {
+        out << std::setw(12) << name;
+    }
+    out << "\n";
+    CounterTotals sum = totals();
+    CounterTotals since;
+    {
+        std::scoped_lock lock(counterMutex);
+        since = baseline;
+    }
+    for (size_t type = 0; type < sum.size(); ++type) {
+        std::array<uint64_t, profileCounterCount> values;
+        bool any = false;
+        for (size_t c = 0; c < profileCounterCount; ++c) {
+            values[c] = sum[type][c] - since[type][c];
+            any = any || values[c] != 0;
+        }
+        if (!any) continue;
+        const std::string& name = type == noSpecies ? std::string("(model)") : AgentTypes::name(static_cast<AgentTypeId>(type));
+        out << "  " << std::left << std::setw(12) << name << std::right;
+        for (uint64_t value : values) {
+            out << std::setw(12) << value;
+        }
+        out << "\n";
+    }
+    out << "---------------------------------\n";
+}
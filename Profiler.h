@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include "AgentType.h"
+#include "Trace.h"
+
+// NHAGW_PROFILE=1 compiles the step timers and per-species counters into Model. It defaults to
+// on unless NDEBUG is defined, so release builds carry none of it. Tracing has its own switch,
+// NHAGW_TRACE (see Trace.h); without the profiler, phases still appear on the timeline.
+#ifndef NHAGW_PROFILE
+#ifdef NDEBUG
+#define NHAGW_PROFILE 0
+#else
+#define NHAGW_PROFILE 1
+#endif
+#endif
+
+// Parts of Model::step(). The sequential and shuffled schedulers interleave prepare() and act()
+// agent by agent, so their whole agent pass is timed as Act.
+enum class ProfilePhase { Environment, Prepare, Act, Queues, Step };
+constexpr size_t profilePhaseCount = 5;
+
+// Name of phase in print() and on the trace timeline
+inline const char* profilePhaseName(ProfilePhase phase) {
+    static const char* const names[profilePhaseCount] = { "Environment", "Prepare", "Act", "Queues", "Step" };
+    return names[static_cast<size_t>(phase)];
+}
+
+// Per-species events: range queries issued, handle lookups made, agents added, removed and moved
+enum class ProfileCounter { NeighborQueries, Lookups, Births, Deaths, Moves };
+constexpr size_t profileCounterCount = 5;
+
+// Rolling phase timings over the last window steps plus running counters. Timings are recorded
+// by the stepping thread and counters bumped from any thread; print() may run concurrently
+// with both, e.g. from the CLI thread while the simulation plays. Each thread counts into its
+// own rows, so worker threads never share a counter's cache line; print() sums the rows.
+class Profiler {
+public:
+    static constexpr size_t window = 256;
+    // Counter row for events raised outside any species' prepare()/act()
+    static constexpr AgentTypeId noSpecies = AgentTypes::maxTypes;
+
+    // Species whose prepare()/act() is running on this thread, or noSpecies
+    static thread_local AgentTypeId actingType;
+
+    // Sets actingType for the lifetime of the scope
+    class ActingScope {
+    private:
+        AgentTypeId previous;
+    public:
+        explicit ActingScope(AgentTypeId type) : previous(actingType) { actingType = type; }
+        ~ActingScope() { actingType = previous; }
+    };
+
+    // Records the time from construction to destruction against phase, and as a trace event
+    // when tracing is on
+    class PhaseScope {
+    private:
+        Profiler& profiler;
+        ProfilePhase phase;
+        std::chrono::steady_clock::time_point start;
+    public:
+        PhaseScope(Profiler& p, ProfilePhase ph) : profiler(p), phase(ph), start(std::chrono::steady_clock::now()) {}
+        ~PhaseScope() { profiler.record(phase, start); }
+    };
+
+    // Adds the time since start as a sample of phase
+    void record(ProfilePhase phase, std::chrono::steady_clock::time_point start);
+    void count(AgentTypeId type, ProfileCounter counter) {
+        std::atomic<uint64_t>& value = threadCounters()[type][static_cast<size_t>(counter)];
+        // Only this thread writes its rows, so no read-modify-write is needed
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    // Counters restart from zero; their totals so far become the baseline print() subtracts
+    void reset();
+    // p50/p90/p99/max per phase over the window, then the counter totals per species
+    void print(std::ostream& out) const;
+
+private:
+    mutable std::mutex sampleMutex;
+    std::array<std::array<double, window>, profilePhaseCount> samples{};
+    std::array<size_t, profilePhaseCount> sampleCount{};
+    std::array<size_t, profilePhaseCount> nextSample{};
+
+    using CounterRows = std::array<std::array<std::atomic<uint64_t>, profileCounterCount>, AgentTypes::maxTypes + 1>;
+    using CounterTotals = std::array<std::array<uint64_t, profileCounterCount>, AgentTypes::maxTypes + 1>;
+    struct alignas(64) ThreadCounters {
+        std::thread::id thread;
+        CounterRows rows{};
+    };
+    // One entry per thread that has counted, kept after the thread exits so its counts stay
+    // in the totals. A thread that reuses an exited thread's id takes over its rows.
+    mutable std::mutex counterMutex;
+    std::vector<std::unique_ptr<ThreadCounters>> threadRows;
+    CounterTotals baseline{};
+
+    // Distinguishes profilers in the per-thread cache even when one reuses another's address
+    static std::atomic<uint64_t> nextId;
+    const uint64_t id = nextId.fetch_add(1, std::memory_order_relaxed);
+    // Rows of the profiler this thread counted for last
+    static thread_local uint64_t cachedId;
+    static thread_local CounterRows* cachedRows;
+
+    CounterRows& threadCounters() {
+        return cachedId == id ? *cachedRows : attachThread();
+    }
+    // Finds or adds this thread's rows and caches them
+    CounterRows& attachThread();
+    CounterTotals totals() const;
+};
+
+#if NHAGW_PROFILE
+// Times the rest of the enclosing block as ProfilePhase::phase
+#define PROFILE_PHASE(profiler, phase) \
+    Profiler::PhaseScope NHAGW_TRACE_CONCAT(profilePhase_, __LINE__)((profiler), ProfilePhase::phase)
+// Attributes counters raised in the rest of the enclosing block to species type
+#define PROFILE_ACTING(type) Profiler::ActingScope NHAGW_TRACE_CONCAT(profileActing_, __LINE__)(type)
+#define PROFILE_COUNT(profiler, type, counter) (profiler).count((type), ProfileCounter::counter)
+// Counts against the species whose agent code is running on this thread
+#define PROFILE_COUNT_ACTING(profiler, counter) (profiler).count(Profiler::actingType, ProfileCounter::counter)
+#else
+#if NHAGW_TRACE
+// Phases still go on the timeline; whole steps are traced by Model::step itself
+#define PROFILE_PHASE(profiler, phase) \
+    Trace::Scope NHAGW_TRACE_CONCAT(profilePhase_, __LINE__)( \
+        ProfilePhase::phase == ProfilePhase::Step ? nullptr : profilePhaseName(ProfilePhase::phase), "phase")
+#else
+#define PROFILE_PHASE(profiler, phase) ((void)0)
+#endif
+#define PROFILE_ACTING(type) ((void)0)
+#define PROFILE_COUNT(profiler, type, counter) ((void)0)
+#define PROFILE_COUNT_ACTING(profiler, counter) ((void)0)
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Reference into a SlotMap: an entry index plus the generation the entry had when the
+// handle was issued. Once the entry is erased its generation moves on, so old handles
+// stop resolving even after the index is reused.
+struct SlotHandle {
+    static constexpr uint32_t nullIndex = UINT32_MAX;
+
+    uint32_t index = nullIndex;
+    uint32_t generation = 0;
+
+    bool isNull() const { return index == nullIndex; }
+    bool operator==(const SlotHandle& other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle& other) const { return !(*this == other); }
+};
+
+// Dense array of values addressed by generational handles. insert, erase and get are O(1);
+// erased entries are reused most recently freed first.
+template <class Value>
+class SlotMap {
+private:
+    struct Entry {
+        Value value{};
+        uint32_t generation = 0;
+        bool live = false;
+    };
+    std::vector<Entry> entries;
+    std::vector<uint32_t> freeList;
+    size_t liveCount = 0;
+
+public:
+    SlotHandle insert(const Value& value) {
+        uint32_t index;
+        if (!freeList.empty()) {
+            index = freeList.back();
+            freeList.pop_back();
+        }
+        else {
+            index = static_cast<uint32_t>(entries.size());
+            entries.emplace_back();
+        }
+        Entry& entry = entries[index];
+        entry.value = value;
+        entry.live = true;
+        liveCount++;
+        return { index, entry.generation };
+    }
+
+    // Returns false if handle was already stale
+    bool erase(SlotHandle handle) {
+        if (!get(handle)) {
+            return false;
+        }
+        Entry& entry = entries[handle.index];
+        entry.live = false;
+        entry.generation++;
+        freeList.push_back(handle.index);
+        liveCount--;
+        return true;
+    }
+
+    Value* get(SlotHandle handle) {
+        if (handle.index >= entries.size()) return nullptr;
+        Entry& entry = entries[handle.index];
+        return (entry.live && entry.generation == handle.generation) ? &entry.value : nullptr;
+    }
+    const Value* get(SlotHandle handle) const {
+        return const_cast<SlotMap*>(this)->get(handle);
+    }
+
+    size_t size() const { return liveCount; }
+    // Largest index ever issued plus one; per-entry side tables can be sized to this
+    size_t capacity() const { return entries.size(); }
+    void reserve(size_t n) {
+        entries.reserve(n);
+        freeList.reserve(n);
+    }
+
+    // Raw state for checkpoints: generation and liveness of each entry below capacity(), and
+    // the free list in reuse order. restore() rebuilds the map from exactly these, so handles
+    // issued before a checkpoint resolve after it and new ones come out the same.
+    uint32_t generationAt(size_t index) const { return entries[index].generation; }
+    bool liveAt(size_t index) const { return entries[index].live; }
+    const std::vector<uint32_t>& getFreeList() const { return freeList; }
+    // Live entries come back value-initialised; set them through get()
+    void restore(const uint32_t* generations, const uint8_t* live, size_t count,
+                 const uint32_t* freeIndices, size_t freeCount) {
+        entries.assign(count, Entry{});
+        liveCount = 0;
+        for (size_t i = 0; i < count; ++i) {
+            entries[i].generation = generations[i];
+            entries[i].live = live[i] != 0;
+            liveCount += entries[i].live;
+        }
+        freeList.assign(freeIndices, freeIndices + freeCount);
+    }
+};
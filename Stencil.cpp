@@ -0,0 +1,49 @@
+#include "Stencil.h"
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdlib>
+
+namespace {
+
+std::vector<CellOffset> buildDiamond(int radius) {
+    std::vector<CellOffset> offsets;
+    offsets.reserve(2 * radius * radius + 2 * radius + 1);
+    for (int dx = -radius; dx <= radius; ++dx) {
+        int maxDy = radius - std::abs(dx);
+        for (int dy = -maxDy; dy <= maxDy; ++dy) {
+            offsets.push_back({ dx, dy });
+        }
+    }
+    return offsets;
+}
+
+}
+
+const std::vector<CellOffset>& Stencil::diamond(int radius) {
+    static const std::array<std::vector<CellOffset>, maxCachedRadius + 1> cached = [] {
+        std::array<std::vector<CellOffset>, maxCachedRadius + 1> stencils;
+        for (int r = 0; r <= maxCachedRadius; ++r) {
+            stencils[r] = buildDiamond(r);
+        }
+        return stencils;
+    }();
+    if (radius < 0) {
+        static const std::vector<CellOffset> none;
+        return none;
+    }
+    if (radius <= maxCachedRadius) {
+        return cached[radius];
+    }
+
+    // Rare: built once per radius and kept, so the reference stays valid
+    static std::mutex m;
+    static std::map<int, std::unique_ptr<std::vector<CellOffset>>> large;
+    std::scoped_lock lock(m);
+    auto& stencil = large[radius];
+    if (!stencil) {
+        stencil = std::make_unique<std::vector<CellOffset>>(buildDiamond(radius));
+    }
+    return *stencil;
+}
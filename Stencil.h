@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+struct CellOffset {
+    int dx;
+    int dy;
+};
+
+// Precomputed neighbourhood shapes, built once and shared by every cell and thread.
+class Stencil {
+public:
+    // Radii up to this are built up front; larger ones on first use
+    static constexpr int maxCachedRadius = 16;
+
+    // Every offset within Manhattan distance radius, centre included, row by row
+    // (dx ascending, then dy ascending)
+    static const std::vector<CellOffset>& diamond(int radius);
+    // The four orthogonal neighbours in diamond(1) order
+    static constexpr CellOffset orthogonal[4] = { { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 } };
+};
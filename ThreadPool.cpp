@@ -0,0 +1,82 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    for (unsigned i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::scoped_lock lock(m);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::runTasks(const std::function<void(size_t)>* job, size_t count) {
+    for (size_t i = nextIndex.fetch_add(1); i < count; i = nextIndex.fetch_add(1)) {
+        TRACE_SCOPE_ARG("task", "pool", i);
+        (*job)(i);
+        completed.fetch_add(1);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    Trace::setThreadName("pool worker");
+    unsigned long long seen = 0;
+    while (true) {
+        const std::function<void(size_t)>* job;
+        size_t count;
+        {
+            std::unique_lock lock(m);
+            wakeWorkers.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            job = task;
+            count = taskCount;
+            activeWorkers++;
+        }
+        // A worker that wakes after the job was already finished finds no indices left
+        runTasks(job, count);
+        {
+            std::scoped_lock lock(m);
+            activeWorkers--;
+        }
+        jobDone.notify_all();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& job) {
+    if (count == 0) {
+        return;
+    }
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            job(i);
+        }
+        return;
+    }
+    {
+        // Late workers from the previous job must be out before the index is reset
+        std::unique_lock lock(m);
+        jobDone.wait(lock, [&] { return activeWorkers == 0; });
+        task = &job;
+        taskCount = count;
+        nextIndex = 0;
+        completed = 0;
+        generation++;
+    }
+    wakeWorkers.notify_all();
+    runTasks(&job, count);
+
+    // Wait for the last tasks and for every worker to let go of job before it goes out of scope
+    std::unique_lock lock(m);
+    jobDone.wait(lock, [&] { return completed == count && activeWorkers == 0; });
+}
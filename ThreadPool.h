@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <cstddef>
+
+// Fixed set of worker threads that live as long as the pool. The calling thread
+// takes part in every parallelFor, so a pool of size 1 has no workers and runs inline.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::mutex m;
+    std::condition_variable wakeWorkers;
+    std::condition_variable jobDone;
+    bool stopping = false;
+
+    // Current job; generation changes each time a new job is published
+    unsigned long long generation = 0;
+    const std::function<void(size_t)>* task = nullptr;
+    size_t taskCount = 0;
+    std::atomic<size_t> nextIndex{ 0 };
+    std::atomic<size_t> completed{ 0 };
+    unsigned activeWorkers = 0;
+
+    void workerLoop();
+    void runTasks(const std::function<void(size_t)>* job, size_t count);
+
+public:
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads taking part in a parallelFor, including the caller
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Calls job(i) for every i in [0, count), spread over the workers and the
+    // calling thread. Returns once every call has finished.
+    void parallelFor(size_t count, const std::function<void(size_t)>& job);
+};
@@ -0,0 +1,161 @@
+#include "TimeSeries.h"
+#include "Model.h"
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <stdexcept>
+
+namespace {
+
+const char* weatherNames[weatherStateCount] = { "Drought", "Sunny", "Cloudy", "Rainy", "HeavyRain", "Stormy" };
+
+template <class T>
+void writeRaw(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
+
+TimeSeriesWriter::TimeSeriesWriter(const Model& model, const std::string& path, SeriesFormat f, unsigned n)
+    : speciesCount(model.getStores().size()), format(f), every(n > 0 ? n : 1) {
+    columns.push_back("step");
+    columns.push_back("dropped");
+    for (const auto& store : model.getStores()) {
+        columns.push_back(store->getType() + ".count");
+        columns.push_back(store->getType() + ".meanEnergy");
+    }
+    for (const char* name : weatherNames) {
+        columns.push_back(std::string("weather.") + name);
+    }
+    columns.push_back("water.total");
+    columns.push_back("nutrients.total");
+    rowWidth = columns.size();
+
+    out.open(path, format == SeriesFormat::Binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("cannot open " + path);
+    }
+    ring.assign(queueRows * rowWidth, 0.0);
+    block.assign(columns.size(), std::vector<double>(blockRows));
+    writeHeader();
+    thread = std::thread(&TimeSeriesWriter::run, this);
+}
+
+TimeSeriesWriter::~TimeSeriesWriter() {
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+}
+
+void TimeSeriesWriter::record(const Model& model) {
+    if (model.getStepCount() % every != 0) {
+        return;
+    }
+    uint64_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) == queueRows) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        pendingDropped++;
+        return;
+    }
+
+    double* row = &ring[(h % queueRows) * rowWidth];
+    size_t c = 0;
+    row[c++] = static_cast<double>(model.getStepCount());
+    row[c++] = static_cast<double>(pendingDropped);
+    pendingDropped = 0;
+    const auto& stores = model.getStores();
+    for (size_t s = 0; s < speciesCount; ++s) {
+        const AgentColumns& agents = stores[s]->getColumns();
+        size_t live = agents.activeSize();
+        long long energy = std::accumulate(agents.energy.begin(), agents.energy.begin() + live, 0LL);
+        row[c++] = static_cast<double>(live);
+        row[c++] = live > 0 ? static_cast<double>(energy) / live : 0.0;
+    }
+    ModelMetrics metrics = model.getMetrics();
+    for (long long count : metrics.weather) {
+        row[c++] = static_cast<double>(count);
+    }
+    row[c++] = static_cast<double>(metrics.water);
+    row[c++] = static_cast<double>(metrics.nutrients);
+
+    head.store(h + 1, std::memory_order_release);
+}
+
+void TimeSeriesWriter::run() {
+    while (true) {
+        // Checked before draining, so every row published before the destructor ran is written
+        bool stop = stopping.load(std::memory_order_acquire);
+        uint64_t t = tail.load(std::memory_order_relaxed);
+        uint64_t h = head.load(std::memory_order_acquire);
+        bool idle = t == h;
+        // In batches of at most blockRows: write them out, then hand their slots back at once
+        while (t < h) {
+            uint64_t batchEnd = std::min<uint64_t>(h, t + blockRows);
+            for (; t < batchEnd; ++t) {
+                writeRow(&ring[(t % queueRows) * rowWidth]);
+            }
+            if (!text.empty()) {
+                out.write(text.data(), static_cast<std::streamsize>(text.size()));
+                text.clear();
+            }
+            tail.store(t, std::memory_order_release);
+        }
+        if (stop) {
+            break;
+        }
+        if (idle) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    flushBlock();
+    out.flush();
+}
+
+void TimeSeriesWriter::writeHeader() {
+    if (format == SeriesFormat::Csv) {
+        for (size_t c = 0; c < columns.size(); ++c) {
+            out << (c ? "," : "") << columns[c];
+        }
+        out << '\n';
+        return;
+    }
+    out.write("NHTS", 4);
+    writeRaw(out, version);
+    writeRaw(out, static_cast<uint32_t>(columns.size()));
+    for (const std::string& name : columns) {
+        writeRaw(out, static_cast<uint16_t>(name.size()));
+        out.write(name.data(), name.size());
+    }
+}
+
+void TimeSeriesWriter::writeRow(const double* row) {
+    written.fetch_add(1, std::memory_order_relaxed);
+    if (format == SeriesFormat::Csv) {
+        // 15 significant digits keep counts and step numbers exact well past a million steps
+        char buffer[32];
+        for (size_t c = 0; c < rowWidth; ++c) {
+            if (c) text += ',';
+            char* end = std::to_chars(buffer, buffer + sizeof(buffer), row[c], std::chars_format::general, 15).ptr;
+            text.append(buffer, end);
+        }
+        text += '\n';
+        return;
+    }
+    for (size_t c = 0; c < rowWidth; ++c) {
+        block[c][blockFill] = row[c];
+    }
+    if (++blockFill == blockRows) {
+        flushBlock();
+    }
+}
+
+void TimeSeriesWriter::flushBlock() {
+    if (format != SeriesFormat::Binary || blockFill == 0) {
+        return;
+    }
+    writeRaw(out, static_cast<uint32_t>(blockFill));
+    for (const std::vector<double>& column : block) {
+        out.write(reinterpret_cast<const char*>(column.data()), blockFill * sizeof(double));
+    }
+    blockFill = 0;
+}
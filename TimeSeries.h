@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+class Model;
+
+enum class SeriesFormat {
+    Binary,  // columnar blocks of float64, see TimeSeriesWriter
+    Csv      // header line, then one line per recorded step
+};
+
+// Per-step statistics written to disk by a background thread. The simulation thread fills a
+// preallocated row and hands it over through a single-producer, single-consumer ring; if the
+// ring is full the row is dropped and counted rather than waited for, so stepping never blocks
+// on the file. The writer drains the ring in batches and formats each batch into one buffer
+// before writing it.
+//
+// Columns are fixed when the writer is created: "step", "dropped" (recorded steps lost just
+// before this row because the writer fell behind, so gaps show in the file itself), then
+// "<Species>.count" and "<Species>.meanEnergy" for every store the model has,
+// "weather.<State>" for each weather state, "water.total" and "nutrients.total".
+//
+// Binary layout (native byte order): "NHTS", uint32 version, uint32 column count, then per
+// column a uint16 name length and the name. Then blocks until end of file, each a uint32 row
+// count followed by that many float64 values for every column in turn.
+class TimeSeriesWriter {
+public:
+    static constexpr uint32_t version = 2;
+    // About a second of a small grid stepping flat out; a few MB for the usual columns
+    static constexpr size_t queueRows = 65536;
+    static constexpr size_t blockRows = 4096;
+
+    // Opens path and starts the writer thread. Records every every-th step. Throws
+    // std::runtime_error if path cannot be opened.
+    TimeSeriesWriter(const Model& model, const std::string& path, SeriesFormat format, unsigned every = 1);
+    // Writes out everything still queued, then closes the file
+    ~TimeSeriesWriter();
+
+    TimeSeriesWriter(const TimeSeriesWriter&) = delete;
+    TimeSeriesWriter& operator=(const TimeSeriesWriter&) = delete;
+
+    // Called by Model::step() on the simulation thread
+    void record(const Model& model);
+
+    const std::vector<std::string>& getColumns() const { return columns; }
+    unsigned long long getWritten() const { return written.load(std::memory_order_relaxed); }
+    unsigned long long getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<std::string> columns;
+    size_t rowWidth;
+    size_t speciesCount;
+    SeriesFormat format;
+    unsigned every;
+    std::ofstream out;
+
+    // queueRows rows of rowWidth values; the consumer owns [tail, head) once published by head
+    std::vector<double> ring;
+    alignas(64) std::atomic<uint64_t> head{ 0 };
+    alignas(64) std::atomic<uint64_t> tail{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::atomic<unsigned long long> written{ 0 };
+    std::atomic<unsigned long long> dropped{ 0 };
+    // Simulation thread only: steps dropped since the last queued row
+    unsigned long long pendingDropped = 0;
+
+    // Writer thread only: the binary block being filled column by column, or the CSV text of
+    // the current batch
+    std::vector<std::vector<double>> block;
+    size_t blockFill = 0;
+    std::string text;
+    std::thread thread;
+
+    void run();
+    void writeHeader();
+    void writeRow(const double* row);
+    void flushBlock();
+};
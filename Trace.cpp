@@ -0,0 +1,174 @@
+#include "Trace.h"
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <iomanip>
+
+std::atomic<bool> Trace::active{ false };
+
+namespace {
+
+// Slots are relaxed atomics so a dump reading a slot its owner is overwriting is not a data
+// race; head is published with release once the slot is complete.
+struct TraceSlot {
+    std::atomic<const char*> name{ nullptr };
+    std::atomic<const char*> category{ nullptr };
+    std::atomic<int64_t> begin{ 0 };
+    std::atomic<int64_t> duration{ 0 };
+    std::atomic<int64_t> arg{ TraceEvent::noArg };
+};
+
+struct ThreadRing {
+    int tid = 0;
+    std::string name;  // guarded by registryMutex
+    std::unique_ptr<TraceSlot[]> slots = std::make_unique<TraceSlot[]>(Trace::eventsPerThread);
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<uint64_t> cleared{ 0 };  // events below this index were dropped by clear()
+};
+
+std::mutex registryMutex;
+// Rings outlive their threads so events from finished threads can still be dumped
+std::vector<std::shared_ptr<ThreadRing>> rings;
+// Rings whose thread has exited. The next new thread continues one of them, keeping its
+// tid, rather than allocating, so rebuilding a thread pool does not grow the trace.
+std::vector<ThreadRing*> retiredRings;
+
+// The calling thread's ring, handed back to retiredRings when the thread exits
+struct RingOwner {
+    ThreadRing* ring = nullptr;
+    ~RingOwner() {
+        if (ring) {
+            std::scoped_lock lock(registryMutex);
+            retiredRings.push_back(ring);
+        }
+    }
+};
+thread_local RingOwner localRing;
+// Name given before the thread's ring exists; rings are only allocated once a thread records
+thread_local std::string localName;
+
+ThreadRing& ringForThisThread() {
+    if (!localRing.ring) {
+        std::scoped_lock lock(registryMutex);
+        if (!retiredRings.empty()) {
+            localRing.ring = retiredRings.back();
+            retiredRings.pop_back();
+        }
+        else {
+            auto ring = std::make_shared<ThreadRing>();
+            ring->tid = static_cast<int>(rings.size()) + 1;
+            rings.push_back(ring);
+            localRing.ring = ring.get();
+        }
+        localRing.ring->name = localName.empty() ? "thread " + std::to_string(localRing.ring->tid) : localName;
+    }
+    return *localRing.ring;
+}
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+void writeEscaped(std::ostream& out, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+}
+
+}
+
+void Trace::enable(bool on) {
+    active.store(on, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const std::string& name) {
+    localName = name;
+    if (localRing.ring) {
+        std::scoped_lock lock(registryMutex);
+        localRing.ring->name = name;
+    }
+}
+
+int64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::record(const TraceEvent& event) {
+    ThreadRing& ring = ringForThisThread();
+    uint64_t index = ring.head.load(std::memory_order_relaxed);
+    TraceSlot& slot = ring.slots[index % eventsPerThread];
+    slot.name.store(event.name, std::memory_order_relaxed);
+    slot.category.store(event.category, std::memory_order_relaxed);
+    slot.begin.store(event.begin, std::memory_order_relaxed);
+    slot.duration.store(event.duration, std::memory_order_relaxed);
+    slot.arg.store(event.arg, std::memory_order_relaxed);
+    ring.head.store(index + 1, std::memory_order_release);
+}
+
+void Trace::clear() {
+    std::scoped_lock lock(registryMutex);
+    for (auto& ring : rings) {
+        ring->cleared.store(ring->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+void Trace::writeJson(std::ostream& out, int pid) {
+    std::vector<std::shared_ptr<ThreadRing>> snapshot;
+    std::vector<std::string> names;
+    {
+        std::scoped_lock lock(registryMutex);
+        snapshot = rings;
+        for (auto& ring : rings) {
+            names.push_back(ring->name);
+        }
+    }
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (size_t r = 0; r < snapshot.size(); ++r) {
+        ThreadRing& ring = *snapshot[r];
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << pid << ", \"tid\": " << ring.tid
+            << ", \"args\": {\"name\": \"";
+        writeEscaped(out, names[r]);
+        out << "\"}}";
+        first = false;
+
+        uint64_t end = ring.head.load(std::memory_order_acquire);
+        uint64_t begin = std::max(ring.cleared.load(std::memory_order_relaxed), end > eventsPerThread ? end - eventsPerThread : 0);
+        std::vector<TraceEvent> events;
+        events.reserve(end - begin);
+        for (uint64_t i = begin; i < end; ++i) {
+            const TraceSlot& slot = ring.slots[i % eventsPerThread];
+            TraceEvent event;
+            event.name = slot.name.load(std::memory_order_relaxed);
+            event.category = slot.category.load(std::memory_order_relaxed);
+            event.begin = slot.begin.load(std::memory_order_relaxed);
+            event.duration = slot.duration.load(std::memory_order_relaxed);
+            event.arg = slot.arg.load(std::memory_order_relaxed);
+            events.push_back(event);
+        }
+        // The owner may have lapped the copy while it ran. Index after may be mid-write and shares
+        // its slot with after - eventsPerThread, so only indices above that are known intact.
+        uint64_t after = ring.head.load(std::memory_order_acquire);
+        uint64_t stale = after >= eventsPerThread ? after - eventsPerThread + 1 : 0;
+        size_t skip = stale > begin ? static_cast<size_t>(std::min<uint64_t>(stale - begin, events.size())) : 0;
+
+        for (size_t i = skip; i < events.size(); ++i) {
+            const TraceEvent& event = events[i];
+            if (!event.name) continue;
+            // Trace-event timestamps are microseconds
+            out << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+                << "\", \"ph\": \"X\", \"pid\": " << pid << ", \"tid\": " << ring.tid
+                << ", \"ts\": " << event.begin / 1000.0 << ", \"dur\": " << event.duration / 1000.0;
+            if (event.arg != TraceEvent::noArg) {
+                out << ", \"args\": {\"value\": " << event.arg << "}";
+            }
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+
+// NHAGW_TRACE=1 compiles the timeline's scopes in. Unlike the profiler it stays on in release
+// builds, since stalls and imbalance only mean anything in optimised code; while tracing is off
+// at run time a scope costs one relaxed load.
+#ifndef NHAGW_TRACE
+#define NHAGW_TRACE 1
+#endif
+
+// One complete (begin + duration) event. name and category must outlive the trace, which
+// string literals do.
+struct TraceEvent {
+    const char* name = nullptr;
+    const char* category = nullptr;
+    int64_t begin = 0;     // ns since the trace clock's epoch
+    int64_t duration = 0;  // ns
+    int64_t arg = noArg;   // shown as args.value in the viewer
+
+    static constexpr int64_t noArg = INT64_MIN;
+};
+
+// Process-wide timeline of scoped events. Each thread writes its own fixed-size ring, created on
+// its first event and never shared with another writer, so recording takes no lock; once a ring
+// is full the oldest events are overwritten. A thread that exits leaves its events in its ring
+// and the next new thread carries on in it, under the same tid, so the number of rings is the
+// most threads ever alive at once. writeJson() may run on any thread while others
+// record, and writes Chrome trace-event JSON that chrome://tracing and Perfetto open.
+class Trace {
+public:
+    static constexpr size_t eventsPerThread = size_t(1) << 16;
+
+    static void enable(bool on);
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    // Label for the calling thread in the dump; unnamed threads are "thread N". Cheap: the
+    // thread's ring is not allocated until it records an event.
+    static void setThreadName(const std::string& name);
+    static int64_t now();
+    static void record(const TraceEvent& event);
+    // Every event still held in the rings, oldest first per thread, under process id pid so
+    // traces of several processes can be loaded side by side
+    static void writeJson(std::ostream& out, int pid = 1);
+    // Drops every recorded event; rings stay allocated
+    static void clear();
+
+    // Records the time from construction to destruction, if tracing was on at construction
+    class Scope {
+    private:
+        TraceEvent event;
+    public:
+        Scope(const char* name, const char* category, int64_t arg = TraceEvent::noArg) {
+            if (enabled()) {
+                event.name = name;
+                event.category = category;
+                event.arg = arg;
+                event.begin = now();
+            }
+        }
+        ~Scope() {
+            if (event.name) {
+                event.duration = now() - event.begin;
+                record(event);
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    static std::atomic<bool> active;
+};
+
+#define NHAGW_TRACE_CONCAT_(a, b) a##b
+#define NHAGW_TRACE_CONCAT(a, b) NHAGW_TRACE_CONCAT_(a, b)
+
+#if NHAGW_TRACE
+#define TRACE_SCOPE(name, category) Trace::Scope NHAGW_TRACE_CONCAT(traceScope_, __LINE__)((name), (category))
+#define TRACE_SCOPE_ARG(name, category, arg) \
+    Trace::Scope NHAGW_TRACE_CONCAT(traceScope_, __LINE__)((name), (category), static_cast<int64_t>(arg))
+#else
+#define TRACE_SCOPE(name, category) ((void)0)
+#define TRACE_SCOPE_ARG(name, category, arg) ((void)0)
+#endif
@@ -0,0 +1,264 @@
+#include "Transport.h"
+#include <stdexcept>
+#include <algorithm>
+#include <new>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+std::unique_ptr<Transport> Transport::create(TransportKind kind, int rankCount) {
+    if (kind == TransportKind::Socket) {
+        return std::make_unique<SocketTransport>(rankCount);
+    }
+    return std::make_unique<SharedMemoryTransport>(rankCount);
+}
+
+void Transport::exchange(int peer, const std::vector<char>& outgoing, std::vector<char>& incoming) {
+    if (rank < peer) {
+        send(peer, outgoing);
+        receive(peer, incoming);
+    }
+    else {
+        receive(peer, incoming);
+        send(peer, outgoing);
+    }
+}
+
+void Transport::barrier() {
+    // Everyone reports to rank 0, which releases them once all have arrived
+    std::vector<char> token;
+    if (rank == 0) {
+        for (int r = 1; r < ranks; ++r) {
+            receive(r, token);
+        }
+        for (int r = 1; r < ranks; ++r) {
+            send(r, token);
+        }
+    }
+    else {
+        send(0, token);
+        receive(0, token);
+    }
+}
+
+// --- SharedMemoryTransport ---
+
+namespace {
+
+// Polls before sleeping, since the peer is usually only a few microseconds behind
+constexpr int spinsBeforeSleep = 256;
+
+// Process-shared (not FUTEX_PRIVATE): the word lives in a mapping every rank inherited
+long futex(std::atomic<uint32_t>& word, int op, uint32_t value) {
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op, value, nullptr, nullptr, 0);
+}
+
+// Returns once ready() holds; the other side calls notifySignal() after every change it reads
+template <class Ready>
+void awaitSignal(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiters, Ready ready) {
+    for (int spin = 0; spin < spinsBeforeSleep; ++spin) {
+        if (ready()) return;
+    }
+    while (true) {
+        uint32_t seen = signal.load(std::memory_order_acquire);
+        waiters.fetch_add(1, std::memory_order_seq_cst);
+        if (ready()) {
+            waiters.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+        // Returns at once if signal has moved past seen, so a bump between the check and the
+        // call is not missed; spurious returns and EINTR just go round again
+        futex(signal, FUTEX_WAIT, seen);
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        if (ready()) return;
+    }
+}
+
+void notifySignal(std::atomic<uint32_t>& signal, std::atomic<uint32_t>& waiters) {
+    signal.fetch_add(1, std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) > 0) {
+        futex(signal, FUTEX_WAKE, INT_MAX);
+    }
+}
+
+}
+
+SharedMemoryTransport::SharedMemoryTransport(int rankCount, size_t ringCapacity)
+    : Transport(rankCount), capacity(ringCapacity) {
+    mappedSize = static_cast<size_t>(ranks) * ranks * (sizeof(RingHeader) + capacity);
+    std::string name = "/nhagw-" + std::to_string(getpid()) + "-" + std::to_string(reinterpret_cast<uintptr_t>(this));
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open failed: " + std::string(std::strerror(errno)));
+    }
+    // The mapping is inherited across fork, so the name is not needed past this point
+    shm_unlink(name.c_str());
+    if (ftruncate(fd, static_cast<off_t>(mappedSize)) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("ftruncate failed: " + std::string(std::strerror(error)));
+    }
+    void* mapped = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("mmap failed: " + std::string(std::strerror(errno)));
+    }
+    base = static_cast<char*>(mapped);
+    for (int from = 0; from < ranks; ++from) {
+        for (int to = 0; to < ranks; ++to) {
+            new (ring(from, to)) RingHeader{ {0}, {0}, {0}, {0}, {0}, {0} };
+        }
+    }
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    if (base) {
+        munmap(base, mappedSize);
+    }
+}
+
+SharedMemoryTransport::RingHeader* SharedMemoryTransport::ring(int from, int to) const {
+    size_t index = static_cast<size_t>(from) * ranks + to;
+    return reinterpret_cast<RingHeader*>(base + index * (sizeof(RingHeader) + capacity));
+}
+
+void SharedMemoryTransport::write(int to, const char* bytes, size_t count) {
+    RingHeader* header = ring(rank, to);
+    char* buffer = data(rank, to);
+    uint64_t tail = header->tail.load(std::memory_order_relaxed);
+    while (count > 0) {
+        awaitSignal(header->headSignal, header->headWaiters, [&] {
+            return tail - header->head.load(std::memory_order_acquire) < capacity;
+        });
+        size_t space = capacity - static_cast<size_t>(tail - header->head.load(std::memory_order_acquire));
+        size_t offset = static_cast<size_t>(tail % capacity);
+        size_t chunk = std::min({ count, space, capacity - offset });
+        std::memcpy(buffer + offset, bytes, chunk);
+        tail += chunk;
+        bytes += chunk;
+        count -= chunk;
+        header->tail.store(tail, std::memory_order_release);
+        notifySignal(header->tailSignal, header->tailWaiters);
+    }
+}
+
+void SharedMemoryTransport::read(int from, char* bytes, size_t count) {
+    RingHeader* header = ring(from, rank);
+    const char* buffer = data(from, rank);
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    while (count > 0) {
+        awaitSignal(header->tailSignal, header->tailWaiters, [&] {
+            return header->tail.load(std::memory_order_acquire) != head;
+        });
+        size_t available = static_cast<size_t>(header->tail.load(std::memory_order_acquire) - head);
+        size_t offset = static_cast<size_t>(head % capacity);
+        size_t chunk = std::min({ count, available, capacity - offset });
+        std::memcpy(bytes, buffer + offset, chunk);
+        head += chunk;
+        bytes += chunk;
+        count -= chunk;
+        header->head.store(head, std::memory_order_release);
+        notifySignal(header->headSignal, header->headWaiters);
+    }
+}
+
+void SharedMemoryTransport::send(int peer, const std::vector<char>& message) {
+    uint64_t length = message.size();
+    write(peer, reinterpret_cast<const char*>(&length), sizeof(length));
+    write(peer, message.data(), message.size());
+}
+
+void SharedMemoryTransport::receive(int peer, std::vector<char>& message) {
+    uint64_t length = 0;
+    read(peer, reinterpret_cast<char*>(&length), sizeof(length));
+    message.resize(length);
+    read(peer, message.data(), message.size());
+}
+
+// --- SocketTransport ---
+
+SocketTransport::SocketTransport(int rankCount)
+    : Transport(rankCount), fds(static_cast<size_t>(rankCount) * rankCount, -1) {
+    for (int a = 0; a < ranks; ++a) {
+        for (int b = a + 1; b < ranks; ++b) {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                throw std::runtime_error("socketpair failed: " + std::string(std::strerror(errno)));
+            }
+            fds[a * ranks + b] = pair[0];
+            fds[b * ranks + a] = pair[1];
+        }
+    }
+}
+
+SocketTransport::~SocketTransport() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void SocketTransport::bind(int r) {
+    Transport::bind(r);
+    // Keep only this rank's ends
+    for (int a = 0; a < ranks; ++a) {
+        if (a == rank) continue;
+        for (int b = 0; b < ranks; ++b) {
+            int& fd = fds[a * ranks + b];
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+}
+
+void SocketTransport::write(int peer, const char* bytes, size_t count) {
+    int fd = fds[rank * ranks + peer];
+    while (count > 0) {
+        ssize_t written = ::send(fd, bytes, count, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("send failed: " + std::string(std::strerror(errno)));
+        }
+        bytes += written;
+        count -= static_cast<size_t>(written);
+    }
+}
+
+void SocketTransport::read(int peer, char* bytes, size_t count) {
+    int fd = fds[rank * ranks + peer];
+    while (count > 0) {
+        ssize_t received = ::recv(fd, bytes, count, 0);
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("recv failed: " + std::string(std::strerror(errno)));
+        }
+        if (received == 0) {
+            throw std::runtime_error("peer closed its socket");
+        }
+        bytes += received;
+        count -= static_cast<size_t>(received);
+    }
+}
+
+void SocketTransport::send(int peer, const std::vector<char>& message) {
+    uint64_t length = message.size();
+    write(peer, reinterpret_cast<const char*>(&length), sizeof(length));
+    write(peer, message.data(), message.size());
+}
+
+void SocketTransport::receive(int peer, std::vector<char>& message) {
+    uint64_t length = 0;
+    read(peer, reinterpret_cast<char*>(&length), sizeof(length));
+    message.resize(length);
+    read(peer, message.data(), message.size());
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+enum class TransportKind {
+    SharedMemory,  // POSIX shared-memory ring buffers, one per ordered pair of ranks
+    Socket         // Unix domain socket pairs
+};
+
+// Point-to-point byte messages between the processes of one distributed run. A transport is
+// created before the processes fork, then each process binds to its rank. Messages between
+// two ranks arrive in the order they were sent; send blocks until the peer has taken enough
+// of the message to make room for the rest.
+class Transport {
+protected:
+    int ranks;
+    int rank = 0;
+
+public:
+    explicit Transport(int rankCount) : ranks(rankCount) {}
+    virtual ~Transport() = default;
+
+    Transport(const Transport&) = delete;
+    Transport& operator=(const Transport&) = delete;
+
+    static std::unique_ptr<Transport> create(TransportKind kind, int rankCount);
+
+    // Called once in every process after the fork
+    virtual void bind(int r) { rank = r; }
+    virtual void send(int peer, const std::vector<char>& message) = 0;
+    virtual void receive(int peer, std::vector<char>& message) = 0;
+
+    // Swaps one message each way with peer. The lower rank sends first, so a process that
+    // exchanges with its peers in ascending rank order can never deadlock against another.
+    void exchange(int peer, const std::vector<char>& outgoing, std::vector<char>& incoming);
+    // Returns once every rank has called it
+    void barrier();
+
+    int getRank() const { return rank; }
+    int getRankCount() const { return ranks; }
+};
+
+class SharedMemoryTransport : public Transport {
+private:
+    // Single-producer single-consumer ring. head and tail only ever grow; the byte at
+    // position p lives at data[p % capacity]. A side that finds the ring empty or full sleeps
+    // on a futex word the other side bumps after every advance; the waiter counts let the
+    // other side skip the wake-up call when nobody sleeps.
+    struct RingHeader {
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+        alignas(64) std::atomic<uint32_t> headSignal;
+        std::atomic<uint32_t> headWaiters;
+        alignas(64) std::atomic<uint32_t> tailSignal;
+        std::atomic<uint32_t> tailWaiters;
+    };
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "rings are shared between processes");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words are plain 32-bit integers");
+
+    char* base = nullptr;
+    size_t mappedSize = 0;
+    size_t capacity;
+
+    RingHeader* ring(int from, int to) const;
+    char* data(int from, int to) const { return reinterpret_cast<char*>(ring(from, to)) + sizeof(RingHeader); }
+    void write(int to, const char* bytes, size_t count);
+    void read(int from, char* bytes, size_t count);
+
+public:
+    SharedMemoryTransport(int rankCount, size_t ringCapacity = size_t(1) << 20);
+    ~SharedMemoryTransport() override;
+
+    void send(int peer, const std::vector<char>& message) override;
+    void receive(int peer, std::vector<char>& message) override;
+};
+
+class SocketTransport : public Transport {
+private:
+    // fds[a * ranks + b] is rank a's end of the socket it shares with rank b
+    std::vector<int> fds;
+
+    void write(int peer, const char* bytes, size_t count);
+    void read(int peer, char* bytes, size_t count);
+
+public:
+    explicit SocketTransport(int rankCount);
+    ~SocketTransport() override;
+
+    void bind(int r) override;
+    void send(int peer, const std::vector<char>& message) override;
+    void receive(int peer, std::vector<char>& message) override;
+};
@@ -4,46 +4,55 @@
 #include "AgentPropertyMap.h"
 #include <iostream>
 
-Tree::Tree(Model* model, long long int id, Cell* associated_cell)
-    : Agent(model, id, "Tree", associated_cell), age(0), health(20) {
+Tree::Tree(Model* model, AgentColumns* columns, size_t slot)
+    : Agent(model, columns, slot) {
+}
+
+AgentRecord Tree::create(Cell* cell) {
+    // The id is assigned when the model registers the agent
+    AgentRecord record;
+    record.cellIndex = cell->getIndex();
+    record.energy = 20;
+    return record;
 }
 
 void Tree::grow() {
+    Cell* cell = getCell();
     if (cell->getSoilSaturation() > 0 && cell->getNutrients() > 0) {
-        age++;
-        health += 10;
+        age()++;
+        health() += 10;
         cell->modifySoilSaturation(-1);
         cell->modifyNutrients(-1);
     }
     else if (cell->getSoilSaturation() > 0) {
         cell->modifySoilSaturation(-1);
-        health -= 5;
+        health() -= 5;
     }
     else if (cell->getNutrients() > 0) {
         cell->modifyNutrients(-1);
-        health -= 5;
+        health() -= 5;
     }
     else {
-        health -= 20;
+        health() -= 20;
     }
 }
 
 void Tree::reproduce() {
-    if (health > 50) {
-        Cell* new_cell = cell->getRandomNeighbor();
+    if (health() > 50) {
+        RandomStream rng = randomStream(RandomPurpose::Reproduce);
+        Cell* new_cell = getCell()->getRandomNeighbor(rng);
         if (new_cell) {  // Make sure we have a valid cell
             // Create the new tree and immediately queue it for addition
-            std::unique_ptr<Tree> offspring = std::make_unique<Tree>(model, model->getNextID(), new_cell);
-            model->queueAgentForAddition(std::move(offspring));
-            health -= 30;
+            model->queueAgentForAddition<Tree>(Tree::create(new_cell));
+            health() -= 30;
         }
     }
 }
 
 void Tree::die() {
-    if (health <= 0) {
-        cell->modifyNutrients(age / 5);
-        model->queueAgentForRemoval(unique_id);
+    if (health() <= 0) {
+        getCell()->modifyNutrients(age() / 5);
+        model->queueAgentForRemoval(getHandle());
     }
 }
 
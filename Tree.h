@@ -4,13 +4,18 @@
 #include "Agent.h"
 #include "AgentPropertyMap.h"
 
-class Tree : public Agent {
+class Tree final : public Agent {
 private:
-    int age;
-    int health;
+    // Trees keep their health in the energy column
+    int& health() { return energy(); }
 
 public:
-    Tree(Model* model, long long int id, Cell* associated_cell);
+    static constexpr const char* typeName = "Tree";
+    // Farthest cell a tree reads or writes during act()
+    static constexpr int interactionRange = 1;
+
+    Tree(Model* model, AgentColumns* columns, size_t slot);
+    static AgentRecord create(Cell* cell);
 
     void grow();
     void reproduce();
@@ -19,24 +24,24 @@ public:
     void act() override;
 
     // Getters for GUI
-    int getAge() const { return age; }
-    int getHealth() const { return health; }
+    int getAge() const { return age(); }
+    int getHealth() const { return energy(); }
 
-    // Virtual initialization function
-    void initializeType() override {
+    // Per-type initialization, run once when the type's store is created
+    static void initializeType() {
         // Register color
         //AgentColorMap::registerColor("Tree", sf::Color(34, 139, 34)); // Forest green
             
         // Register properties
         AgentPropertyMap::registerProperty("Tree", "Age", 
             [](const Agent* agent) {
-                const Tree* tree = dynamic_cast<const Tree*>(agent);
+                const Tree* tree = agent->as<Tree>();
                 return std::to_string(tree ? tree->getAge() : 0);
             });
             
         AgentPropertyMap::registerProperty("Tree", "Health", 
             [](const Agent* agent) {
-                const Tree* tree = dynamic_cast<const Tree*>(agent);
+                const Tree* tree = agent->as<Tree>();
                 return std::to_string(tree ? tree->getHealth() : 0);
             });
     }
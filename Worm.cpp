@@ -2,9 +2,16 @@
 #include "Model.h"
 #include "Cell.h"
 
-Worm::Worm(Model* model_ptr, int id, Cell* associated_cell)
-    : Agent(model_ptr, id, "Worm", associated_cell),
-      energy(50), age(0), maxEnergy(100), reproductionThreshold(80), burrowed(false) {
+Worm::Worm(Model* model_ptr, AgentColumns* columns, size_t slot)
+    : Agent(model_ptr, columns, slot) {
+}
+
+AgentRecord Worm::create(Cell* cell) {
+    // The id is assigned when the model registers the agent
+    AgentRecord record;
+    record.cellIndex = cell->getIndex();
+    record.energy = 50;
+    return record;
 }
 
 void Worm::initializeType() {
@@ -13,24 +20,24 @@ void Worm::initializeType() {
 
 void Worm::prepare() {
     // Prepare for the next step
-    age++;
-    energy--;
+    age()++;
+    energy()--;
 
     Cell* current = getCell();
     if (current) {
-        burrowed = (current->getWeather() == weatherState::Drought) || (current->getWeather() == weatherState::Sunny);
+        setFlag(burrowedFlag, (current->getWeather() == weatherState::Drought) || (current->getWeather() == weatherState::Sunny));
     }
 }
 
 void Worm::act() {
     // Main behavior loop
-    if (energy <= 0 || age > 100) {
+    if (energy() <= 0 || age() > 100) {
         // Add age as nutrients to the cell
         Cell* currentCell = getCell();
         if (currentCell) {
-            currentCell->modifyNutrients(age);
+            currentCell->modifyNutrients(age());
         }
-        model->queueAgentForRemoval(unique_id);
+        model->queueAgentForRemoval(getHandle());
         return;
     }
 
@@ -38,7 +45,7 @@ void Worm::act() {
     eat();
     
     // If we have enough energy, try to reproduce
-    if (energy >= reproductionThreshold) {
+    if (energy() >= reproductionThreshold) {
         reproduce();
     }
     
@@ -56,8 +63,13 @@ void Worm::eat() {
         int nutrients = currentCell->getNutrients();
         if (nutrients > 0) {
             int amountEaten = std::min(10, nutrients);
+            if (IntentBuffer* intents = model->deferredIntents(currentCell->getIndex())) {
+                // Worms sharing a cell split what is actually there after act
+                intents->eat(getHandle(), currentCell->getIndex(), amountEaten, maxEnergy);
+                return;
+            }
             currentCell->modifyNutrients(-amountEaten);
-            energy = std::min(maxEnergy, energy + amountEaten);
+            energy() = std::min(maxEnergy, energy() + amountEaten);
         }
     }
 }
@@ -66,10 +78,11 @@ void Worm::move() {
     // Move to a random neighboring cell
     Cell* currentCell = getCell();
     if (currentCell) {
-        Cell* newCell = currentCell->getRandomNeighbor();
+        RandomStream rng = randomStream(RandomPurpose::Move);
+        Cell* newCell = currentCell->getRandomNeighbor(rng);
         if (newCell) {
-            model->moveAgent(unique_id, newCell);
-            energy--; // Moving costs energy
+            model->moveAgent(getHandle(), newCell);
+            energy()--; // Moving costs energy
         }
     }
 }
@@ -78,25 +91,25 @@ void Worm::reproduce() {
     // Create a new worm in a neighboring cell
     Cell* currentCell = getCell();
     if (currentCell) {
-        Cell* newCell = currentCell->getRandomNeighbor();
+        RandomStream rng = randomStream(RandomPurpose::Reproduce);
+        Cell* newCell = currentCell->getRandomNeighbor(rng);
         if (newCell) {
-            std::unique_ptr<Worm> offspring = std::make_unique<Worm>(model, model->getNextID(), newCell);
-            model->queueAgentForAddition(std::move(offspring));
-            energy -= 40; // Reproduction costs energy
+            model->queueAgentForAddition<Worm>(Worm::create(newCell));
+            energy() -= 40; // Reproduction costs energy
         }
     }
 }
 
 void Worm::ageAndDie() {
     // Chance of death increases with age
-    if (age > 50) {
-        std::uniform_int_distribution<int> dist(0, 100);
-        if (dist(model->getRNG()) < (age - 50)) {
+    if (age() > 50) {
+        // Uniform in [0, 100]
+        if (static_cast<int>(randomStream(RandomPurpose::Death).below(101)) < (age() - 50)) {
             Cell* currentCell = getCell();
             if (currentCell) {
-                currentCell->modifyNutrients(age);
+                currentCell->modifyNutrients(age());
             }
-            model->queueAgentForRemoval(unique_id);
+            model->queueAgentForRemoval(getHandle());
         }
     }
 } 
\ No newline at end of file
@@ -2,25 +2,28 @@
 
 #include "Agent.h"
 
-class Worm : public Agent {
+class Worm final : public Agent {
 private:
-    int energy;
-    int age;
-    int maxEnergy;
-    int reproductionThreshold;
-    bool burrowed;
+    static constexpr int maxEnergy = 100;
+    static constexpr int reproductionThreshold = 80;
+    static constexpr uint8_t burrowedFlag = 1 << 0;
 
 public:
-    Worm(Model* model_ptr, int id, Cell* associated_cell);
-    
+    static constexpr const char* typeName = "Worm";
+    // Farthest cell a worm reads or writes during act()
+    static constexpr int interactionRange = 1;
+
+    Worm(Model* model_ptr, AgentColumns* columns, size_t slot);
+    static AgentRecord create(Cell* cell);
+    static void initializeType();
+
     void prepare() override;
     void act() override;
-    void initializeType() override;
 
     void eat();
     void move();
     void reproduce();
     void ageAndDie();
 
-    bool isBurrowed() const { return burrowed; };
-}; 
\ No newline at end of file
+    bool isBurrowed() const { return observedFlag(burrowedFlag); };
+};
\ No newline at end of file
@@ -0,0 +1,603 @@
+// Benchmarks for the simulation hot paths. Built from every top-level source except main.cpp
+// plus this file, e.g.
+//   g++ -std=c++17 -O2 -march=native -pthread -I. $(ls *.cpp | grep -v '^main.cpp$') bench/Benchmarks.cpp -o nhagw_bench
+//
+//   nhagw_bench [--sizes 10,64,256] [--densities 0.5,2] [--min-time 0.2] [--threads N]
+//               [--scheduler NAME] [--filter TEXT] [--json PATH]
+//               [--baseline PATH [--threshold PCT]]
+//
+// --full runs grids from 10x10 to 4096x4096. --json writes the results, one benchmark per
+// line. --baseline compares against such a file and exits with status 2 if any benchmark got
+// slower than the threshold (10% by default).
+//
+// --verify runs the self-checks instead of the benchmarks and exits with status 1 if any fails.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <filesystem>
+#include <iterator>
+#include <cstdio>
+#include <unistd.h>
+#include "../Model.h"
+#include "../Population.h"
+#include "../Tree.h"
+#include "../Worm.h"
+#include "../Bird.h"
+#include "../EnvironmentKernel.h"
+#include "../Checkpoint.h"
+#include "../CellAgents.h"
+#include "../SlotMap.h"
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    size_t iterations = 0;
+    double nsPerOp = 0;
+    double itemsPerSecond = 0;
+};
+
+struct BenchOptions {
+    std::vector<int> sizes = { 10, 64, 256 };
+    // Agents per cell, split 2:20:1 between trees, worms and birds as in main's defaults
+    std::vector<double> densities = { 0.5, 2.0 };
+    double minTime = 0.2;
+    unsigned threads = 1;
+    Scheduler scheduler = Scheduler::Sequential;
+    std::string filter;
+};
+
+using Clock = std::chrono::steady_clock;
+
+// Query results are written here so the compiler cannot drop the calls
+volatile size_t sink = 0;
+
+// Repeats op until minTime has passed (and at least three times) after one untimed warm-up.
+// op returns how many items it processed; prepare runs before every op, outside the timed region.
+BenchResult measure(const std::string& name, double minTime,
+                    const std::function<double()>& op, const std::function<void()>& prepare = {}) {
+    if (prepare) prepare();
+    op();
+
+    BenchResult result;
+    result.name = name;
+    double seconds = 0;
+    double items = 0;
+    while (seconds < minTime || result.iterations < 3) {
+        if (prepare) prepare();
+        auto start = Clock::now();
+        items += op();
+        seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        result.iterations++;
+    }
+    result.nsPerOp = seconds * 1e9 / result.iterations;
+    result.itemsPerSecond = seconds > 0 ? items / seconds : 0;
+    return result;
+}
+
+std::unique_ptr<Model> buildModel(int size, double density, const BenchOptions& options) {
+    auto model = std::make_unique<Model>(size, size, true, 42);
+    model->setScheduler(options.scheduler);
+    model->setThreadCount(options.threads);
+    double agents = density * size * size;
+    populate(*model, static_cast<int>(agents * 2 / 23), static_cast<int>(agents * 20 / 23), static_cast<int>(agents / 23));
+    return model;
+}
+
+std::vector<Bird*> birdsOf(Model& model) {
+    std::vector<Bird*> birds;
+    if (AgentStoreBase* store = model.getStore(agentTypeId<Bird>())) {
+        for (size_t slot = 0; slot < store->activeSize(); ++slot) {
+            birds.push_back(static_cast<Bird*>(store->view(slot)));
+        }
+    }
+    return birds;
+}
+
+void runSuite(const BenchOptions& options, std::vector<BenchResult>& results) {
+    auto wanted = [&](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+    auto report = [&](const BenchResult& r) {
+        std::cout << "  " << r.name << ": " << r.nsPerOp / 1e3 << " us/op, "
+            << r.itemsPerSecond << " items/s (" << r.iterations << " iterations)" << std::endl;
+        results.push_back(r);
+    };
+
+    for (int size : options.sizes) {
+        double cells = static_cast<double>(size) * size;
+        std::string grid = "/grid=" + std::to_string(size);
+
+        // Cell-only paths do not depend on the population
+        {
+            auto model = buildModel(size, 0, options);
+            if (wanted("updateEnvironment" + grid)) {
+                report(measure("updateEnvironment" + grid, options.minTime, [&] {
+                    for (int i = 0; i < size * size; ++i) {
+                        model->getCellByIndex(i)->updateEnvironment();
+                    }
+                    return cells;
+                }));
+            }
+            if (wanted("getNeighborsWithinDistance" + grid)) {
+                // A fixed sample of cells, so the cost per call is comparable across sizes
+                std::mt19937 rng(7);
+                std::vector<Cell*> sample(1024);
+                for (Cell*& cell : sample) {
+                    cell = model->getCellByIndex(static_cast<int>(rng() % (size * size)));
+                }
+                size_t found = 0;
+                report(measure("getNeighborsWithinDistance" + grid + "/r=" + std::to_string(Bird::visionRange),
+                    options.minTime, [&] {
+                    for (Cell* cell : sample) {
+                        found += cell->getNeighborsWithinDistance(Bird::visionRange).size();
+                    }
+                    return static_cast<double>(sample.size());
+                }));
+                sink = found;
+            }
+        }
+
+        for (double density : options.densities) {
+            std::ostringstream label;
+            label << grid << "/density=" << density;
+            std::string suffix = label.str();
+
+            // Populations thin out, so the model is rebuilt (untimed) every stepsPerModel steps;
+            // items are the agents alive at the start of each step
+            for (bool shuffled : { false, true }) {
+                std::string name = (shuffled ? "shuffle_step" : "step") + suffix;
+                if (!wanted(name)) continue;
+                constexpr int stepsPerModel = 20;
+                std::unique_ptr<Model> model;
+                int stepsTaken = stepsPerModel;
+                auto prepare = [&] {
+                    if (stepsTaken == stepsPerModel) {
+                        model = buildModel(size, density, options);
+                        stepsTaken = 0;
+                    }
+                };
+                report(measure(name, options.minTime, [&] {
+                    double agents = static_cast<double>(model->getAgentCount());
+                    if (shuffled) {
+                        model->shuffle_step();
+                    }
+                    else {
+                        model->step();
+                    }
+                    stepsTaken++;
+                    return agents;
+                }, prepare));
+            }
+            if (wanted("findPrey" + suffix) || wanted("findMate" + suffix)) {
+                auto model = buildModel(size, density, options);
+                std::vector<Bird*> birds = birdsOf(*model);
+                size_t hits = 0;
+                if (wanted("findPrey" + suffix)) {
+                    report(measure("findPrey" + suffix, options.minTime, [&] {
+                        for (Bird* bird : birds) hits += bird->findPrey() != nullptr;
+                        return static_cast<double>(birds.size());
+                    }));
+                }
+                if (wanted("findMate" + suffix)) {
+                    report(measure("findMate" + suffix, options.minTime, [&] {
+                        for (Bird* bird : birds) hits += bird->findMate() != nullptr;
+                        return static_cast<double>(birds.size());
+                    }));
+                }
+                sink = hits;
+            }
+            if (wanted("processAgentQueues" + suffix)) {
+                // Each commit removes a tenth of the worms, some queued twice, and adds as many back
+                auto model = buildModel(size, density, options);
+                AgentStoreBase* worms = model->getStore(agentTypeId<Worm>());
+                if (!worms || worms->activeSize() == 0) continue;
+                std::mt19937 rng(11);
+                size_t batch = std::max<size_t>(1, worms->activeSize() / 10);
+                auto prepare = [&] {
+                    for (size_t i = 0; i < batch; ++i) {
+                        AgentHandle handle = worms->getColumns().handles[rng() % worms->activeSize()];
+                        model->queueAgentForRemoval(handle);
+                        if (i % 8 == 0) model->queueAgentForRemoval(handle);
+                        Cell* cell = model->getCellByIndex(static_cast<int>(rng() % (size * size)));
+                        model->queueAgentForAddition<Worm>(Worm::create(cell));
+                    }
+                };
+                report(measure("processAgentQueues" + suffix, options.minTime, [&] {
+                    model->processAgentQueues();
+                    return static_cast<double>(batch * 2);
+                }, prepare));
+            }
+        }
+    }
+}
+
+// Self-checks for what the optimised paths promise to preserve
+struct Verifier {
+    int failures = 0;
+
+    void expect(bool ok, const std::string& what) {
+        std::cout << "  " << (ok ? "ok    " : "FAILED") << "  " << what << std::endl;
+        failures += !ok;
+    }
+};
+
+// Every vector path of the water/soil kernel against the scalar one, bit for bit, on random
+// fields and effect tables, over ranges of every length and alignment up to a few vectors
+void verifyEnvironmentKernel(Verifier& verifier) {
+    std::mt19937 rng(3);
+    constexpr size_t cells = 1024;
+    GridFields reference;
+    GridFields candidate;
+    reference.resize(cells);
+    candidate.resize(cells);
+
+    for (KernelPath path : { KernelPath::Sse41, KernelPath::Avx2 }) {
+        std::string name = std::string("environment kernel: ") + kernelPathName(path) + " matches scalar";
+        if (!kernelPathSupported(path)) {
+            std::cout << "  skip    " << name << " (not supported here)" << std::endl;
+            continue;
+        }
+        bool same = true;
+        for (int round = 0; round < 200 && same; ++round) {
+            Climate climate;
+            for (auto& [state, effect] : climate.effects) {
+                effect.waterChange = static_cast<int>(rng() % 21) - 10;
+                effect.evaporationRate = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            }
+            climate.compile();
+            for (size_t i = 0; i < cells; ++i) {
+                // Mostly small values, some large ones so evaporation rounding is exercised
+                reference.water[i] = static_cast<int>(rng() % (round % 2 ? 1000000 : 64));
+                reference.soilSaturation[i] = static_cast<int>(rng() % (Cell::maxSoilSaturation + 3));
+                reference.weather[i] = static_cast<uint8_t>(rng() % weatherStateCount);
+            }
+            candidate.water = reference.water;
+            candidate.soilSaturation = reference.soilSaturation;
+            candidate.weather = reference.weather;
+
+            size_t begin = rng() % 16;
+            size_t end = round < 40 ? begin + round : begin + rng() % (cells - begin);
+            long long expected = updateWaterAndSoilBatch(KernelPath::Scalar, reference, climate, begin, end, Cell::maxSoilSaturation);
+            long long actual = updateWaterAndSoilBatch(path, candidate, climate, begin, end, Cell::maxSoilSaturation);
+            same = expected == actual && reference.water == candidate.water && reference.soilSaturation == candidate.soilSaturation;
+        }
+        verifier.expect(same, name);
+    }
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+bool loadFails(const std::string& path) {
+    try {
+        Checkpoint::load(path);
+        return false;
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+}
+
+// 15 steps, save, restore, 15 more must leave the same checkpoint bytes as 30 straight steps,
+// under each scheduler that steps differently; damaged files must be refused
+void verifyCheckpoints(Verifier& verifier) {
+    std::string base = (std::filesystem::temp_directory_path() / ("nhagw-verify-" + std::to_string(::getpid()))).string();
+    std::string straightPath = base + "-straight.ckpt";
+    std::string resumedPath = base + "-resumed.ckpt";
+    std::string damagedPath = base + "-damaged.ckpt";
+
+    const std::pair<const char*, Scheduler> schedulers[] = {
+        { "sequential", Scheduler::Sequential },
+        { "parallel", Scheduler::Parallel },
+        { "domains", Scheduler::Domains },
+    };
+    for (const auto& [name, scheduler] : schedulers) {
+        auto configure = [&](Model& model) {
+            model.setScheduler(scheduler);
+            model.setThreadCount(4);
+        };
+        Model straight(48, 48, true, 7);
+        configure(straight);
+        populate(straight, 200, 1500, 60);
+        Model resumedStart(48, 48, true, 7);
+        configure(resumedStart);
+        populate(resumedStart, 200, 1500, 60);
+
+        for (int s = 0; s < 30; ++s) straight.step();
+        Checkpoint::save(straight, straightPath);
+
+        for (int s = 0; s < 15; ++s) resumedStart.step();
+        Checkpoint::save(resumedStart, resumedPath);
+        std::unique_ptr<Model> resumed = Checkpoint::load(resumedPath);
+        configure(*resumed);
+        for (int s = 0; s < 15; ++s) resumed->step();
+        Checkpoint::save(*resumed, resumedPath);
+
+        std::string expected = readFile(straightPath);
+        verifier.expect(!expected.empty() && expected == readFile(resumedPath),
+                        std::string("checkpoint: ") + name + " 15 + restore + 15 steps equals 30 steps");
+    }
+
+    // The header starts with the 8-byte magic followed by the uint32 version
+    std::string good = readFile(straightPath);
+    std::string damaged = good;
+    damaged[0] ^= 0x20;
+    writeFile(damagedPath, damaged);
+    verifier.expect(loadFails(damagedPath), "checkpoint: bad magic is refused");
+
+    damaged = good;
+    uint32_t otherVersion = Checkpoint::version + 1;
+    damaged.replace(8, sizeof(otherVersion), reinterpret_cast<const char*>(&otherVersion), sizeof(otherVersion));
+    writeFile(damagedPath, damaged);
+    verifier.expect(loadFails(damagedPath), "checkpoint: other version is refused");
+
+    writeFile(damagedPath, good.substr(0, good.size() / 2));
+    verifier.expect(loadFails(damagedPath), "checkpoint: truncated file is refused");
+
+    writeFile(damagedPath, good.substr(0, 6));
+    verifier.expect(loadFails(damagedPath), "checkpoint: file shorter than the header is refused");
+
+    verifier.expect(loadFails(base + "-missing.ckpt"), "checkpoint: missing file is refused");
+
+    for (const std::string& path : { straightPath, resumedPath, damagedPath }) {
+        std::remove(path.c_str());
+    }
+}
+
+// Erased handles stop resolving, even once their index is reused, and restore() keeps that
+void verifySlotMap(Verifier& verifier) {
+    SlotMap<int> map;
+    SlotHandle first = map.insert(1);
+    SlotHandle second = map.insert(2);
+    verifier.expect(map.erase(first) && map.get(first) == nullptr, "slot map: erased handle no longer resolves");
+    verifier.expect(!map.erase(first), "slot map: erasing twice fails");
+
+    SlotHandle reused = map.insert(3);
+    verifier.expect(reused.index == first.index && reused.generation == first.generation + 1,
+                    "slot map: reused index gets the next generation");
+    verifier.expect(map.get(first) == nullptr && map.get(reused) && *map.get(reused) == 3 && *map.get(second) == 2,
+                    "slot map: stale handle does not resolve to the reused entry");
+
+    map.erase(second);
+    std::vector<uint32_t> generations;
+    std::vector<uint8_t> live;
+    for (size_t i = 0; i < map.capacity(); ++i) {
+        generations.push_back(map.generationAt(i));
+        live.push_back(map.liveAt(i));
+    }
+    SlotMap<int> restored;
+    restored.restore(generations.data(), live.data(), generations.size(), map.getFreeList().data(), map.getFreeList().size());
+    verifier.expect(restored.get(reused) && !restored.get(first) && !restored.get(second) && restored.size() == map.size(),
+                    "slot map: restore keeps which handles resolve");
+    verifier.expect(restored.insert(4) == map.insert(4), "slot map: restore issues the same next handle");
+}
+
+// Random inserts and erases on one cell's list, checking after every operation that each type's
+// run is contiguous and holds exactly its agents, and that the moved() positions stay current
+void verifyCellAgentList(Verifier& verifier) {
+    std::mt19937 rng(5);
+    constexpr AgentTypeId types = 5;
+    CellAgentList list;
+    std::map<uint32_t, std::pair<AgentTypeId, uint32_t>> placed;  // handle index -> type, position
+    uint32_t nextIndex = 0;
+    bool consistent = true;
+
+    for (int op = 0; op < 20000 && consistent; ++op) {
+        if (placed.empty() || rng() % 100 < 55) {
+            SlotHandle agent{ nextIndex++, 0 };
+            AgentTypeId type = static_cast<AgentTypeId>(rng() % types);
+            uint32_t position = list.insert(agent, type, [&](SlotHandle moved, uint32_t at) { placed[moved.index].second = at; });
+            placed[agent.index] = { type, position };
+        }
+        else {
+            auto victim = std::next(placed.begin(), static_cast<long>(rng() % placed.size()));
+            auto [type, position] = victim->second;
+            placed.erase(victim);
+            list.erase(position, type, [&](SlotHandle moved, uint32_t at) { placed[moved.index].second = at; });
+        }
+
+        size_t counted = 0;
+        const SlotHandle* expectedStart = list.all().begin();
+        for (AgentTypeId t = 0; t < types; ++t) {
+            HandleRange run = list.bucket(t);
+            consistent &= run.empty() || run.begin() == expectedStart;
+            expectedStart = run.empty() ? expectedStart : run.end();
+            for (const SlotHandle& agent : run) {
+                auto found = placed.find(agent.index);
+                consistent &= found != placed.end() && found->second.first == t
+                    && found->second.second == static_cast<uint32_t>(&agent - list.all().begin());
+            }
+            counted += run.size();
+        }
+        consistent &= counted == placed.size() && list.size() == placed.size();
+    }
+    verifier.expect(consistent, "cell agent list: runs stay contiguous and positions current under insert/erase");
+
+    // Rebuilding from the saved positions, in any order, must give back the same list
+    CellAgentList rebuilt;
+    std::vector<std::pair<uint32_t, std::pair<AgentTypeId, uint32_t>>> order(placed.begin(), placed.end());
+    std::shuffle(order.begin(), order.end(), rng);
+    bool placedAll = true;
+    for (const auto& [index, where] : order) {
+        placedAll &= rebuilt.place(where.second, list.all()[where.second], where.first);
+    }
+    bool same = placedAll && rebuilt.seal() && rebuilt.size() == list.size();
+    for (AgentTypeId t = 0; t < types && same; ++t) {
+        same = std::equal(list.bucket(t).begin(), list.bucket(t).end(), rebuilt.bucket(t).begin(), rebuilt.bucket(t).end());
+    }
+    verifier.expect(same, "cell agent list: place() and seal() rebuild the same runs");
+}
+
+void writeJson(const std::vector<BenchResult>& results, std::ostream& out) {
+    out << "{\"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << "  {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.nsPerOp << ", \"items_per_second\": " << r.itemsPerSecond << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+// Reads name -> ns_per_op back from a file written by writeJson
+std::map<std::string, double> readBaseline(std::istream& in) {
+    std::map<std::string, double> baseline;
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t ns = line.find("\"ns_per_op\": ");
+        if (name == std::string::npos || ns == std::string::npos) continue;
+        name += 9;
+        size_t nameEnd = line.find('"', name);
+        baseline[line.substr(name, nameEnd - name)] = std::stod(line.substr(ns + 13));
+    }
+    return baseline;
+}
+
+// Prints the change against baseline per benchmark; returns how many got slower than threshold
+int compare(const std::vector<BenchResult>& results, const std::map<std::string, double>& baseline, double threshold) {
+    int regressions = 0;
+    std::cout << "\n--- Compared to baseline ---\n";
+    for (const BenchResult& r : results) {
+        auto it = baseline.find(r.name);
+        if (it == baseline.end() || it->second <= 0) {
+            std::cout << "  " << r.name << ": new\n";
+            continue;
+        }
+        double change = (r.nsPerOp - it->second) / it->second * 100;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        std::cout << "  " << r.name << ": " << (change >= 0 ? "+" : "") << change << "%"
+            << (regressed ? "  REGRESSION" : "") << "\n";
+    }
+    std::cout << regressions << " regression(s) over " << threshold << "%\n";
+    return regressions;
+}
+
+template <class T>
+std::vector<T> parseList(const std::string& text) {
+    std::vector<T> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(static_cast<T>(std::stod(item)));
+    }
+    return values;
+}
+
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold = 10;
+    bool verify = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        try {
+            if (arg == "--verify") {
+                verify = true;
+            }
+            else if (arg == "--full") {
+                options.sizes = { 10, 64, 256, 1024, 4096 };
+            }
+            else if (arg == "--sizes" && hasValue) {
+                options.sizes = parseList<int>(argv[++i]);
+            }
+            else if (arg == "--densities" && hasValue) {
+                options.densities = parseList<double>(argv[++i]);
+            }
+            else if (arg == "--min-time" && hasValue) {
+                options.minTime = std::stod(argv[++i]);
+            }
+            else if (arg == "--threads" && hasValue) {
+                options.threads = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+            }
+            else if (arg == "--scheduler" && hasValue && parseScheduler(argv[i + 1], options.scheduler)) {
+                ++i;
+            }
+            else if (arg == "--filter" && hasValue) {
+                options.filter = argv[++i];
+            }
+            else if (arg == "--json" && hasValue) {
+                jsonPath = argv[++i];
+            }
+            else if (arg == "--baseline" && hasValue) {
+                baselinePath = argv[++i];
+            }
+            else if (arg == "--threshold" && hasValue) {
+                threshold = std::stod(argv[++i]);
+            }
+            else {
+                std::cerr << "Usage: " << argv[0] << " [--full | --sizes N,...] [--densities D,...] [--min-time S]"
+                    << " [--threads N] [--scheduler NAME] [--filter TEXT] [--json PATH]"
+                    << " [--baseline PATH [--threshold PCT]] | --verify" << std::endl;
+                return 1;
+            }
+        }
+        catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (verify) {
+        Verifier verifier;
+        std::cout << "--- Self-checks ---" << std::endl;
+        verifyEnvironmentKernel(verifier);
+        verifyCheckpoints(verifier);
+        verifySlotMap(verifier);
+        verifyCellAgentList(verifier);
+        std::cout << verifier.failures << " failure(s)" << std::endl;
+        return verifier.failures > 0 ? 1 : 0;
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty()) {
+        std::ifstream in(baselinePath);
+        if (!in) {
+            std::cerr << "Cannot read " << baselinePath << std::endl;
+            return 1;
+        }
+        baseline = readBaseline(in);
+    }
+
+    std::vector<BenchResult> results;
+    std::cout << "--- Benchmarks ---" << std::endl;
+    runSuite(options, results);
+
+    if (!jsonPath.empty()) {
+        if (jsonPath == "-") {
+            writeJson(results, std::cout);
+        }
+        else {
+            std::ofstream out(jsonPath);
+            if (!out) {
+                std::cerr << "Cannot write " << jsonPath << std::endl;
+                return 1;
+            }
+            writeJson(results, out);
+        }
+    }
+    if (!baselinePath.empty() && compare(results, baseline, threshold) > 0) {
+        return 2;
+    }
+    return 0;
+}
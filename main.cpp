@@ -1,11 +1,100 @@
-#include <random>
+#include <string>
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
 #include "Model.h"
-#include "Tree.h"
-#include "Worm.h"
-#include "Bird.h"
+#include "Distributed.h"
+#include "Population.h"
+#include "Ensemble.h"
+#include "Trace.h"
+#include "TimeSeries.h"
+#include "Checkpoint.h"
 
+// Steps the model with no CLI thread and no per-step output, then reports throughput
+static void runHeadless(Model& model, int steps) {
+    unsigned long long updates = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; ++i) {
+        updates += model.getAgentCount();
+        model.step();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "\n--- Headless run ---\n";
+    std::cout << "Grid: " << model.getHeight() << " x " << model.getWidth() << "\n";
+    std::cout << "Steps: " << steps << " in " << seconds << " s\n";
+    std::cout << "Steps/s: " << (seconds > 0 ? steps / seconds : 0.0) << "\n";
+    std::cout << "Agent updates/s: " << (seconds > 0 ? updates / seconds : 0.0) << "\n";
+    std::cout << "Agents at end: " << model.getAgentCount() << "\n";
+    std::cout << "--------------------\n";
+}
+
+// Adds one sweep axis, "trees|worms|birds=v1,v2,...", crossing it with the variants so far
+static bool addSweep(std::vector<EnsembleVariant>& variants, const std::string& axis) {
+    size_t eq = axis.find('=');
+    if (eq == std::string::npos) return false;
+    std::string parameter = axis.substr(0, eq);
+    if (parameter != "trees" && parameter != "worms" && parameter != "birds") return false;
+
+    std::vector<EnsembleVariant> crossed;
+    std::stringstream values(axis.substr(eq + 1));
+    std::string value;
+    while (std::getline(values, value, ',')) {
+        int n = std::stoi(value);
+        for (EnsembleVariant variant : variants) {
+            int& target = parameter == "trees" ? variant.trees : parameter == "worms" ? variant.worms : variant.birds;
+            target = n;
+            std::string point = parameter + "=" + std::to_string(n);
+            variant.name = variant.name == "base" ? point : variant.name + " " + point;
+            crossed.push_back(variant);
+        }
+    }
+    if (crossed.empty()) return false;
+    variants = std::move(crossed);
+    return true;
+}
+
+// Writes the trace recorded since --trace turned it on
+static void writeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Cannot write " << path << std::endl;
+        return;
+    }
+    Trace::writeJson(out);
+    std::cout << "Trace written to " << path << std::endl;
+}
+
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+        << "  --height H --width W      Grid size (default 10 x 10)\n"
+        << "  --trees N --worms N --birds N  Initial populations (default 100, 1000, 50)\n"
+        << "  --seed S                  RNG seed, 0 to 65535 (default 42)\n"
+        << "  --torus on|off            Wrap the grid edges (default on)\n"
+        << "  --scheduler NAME          sequential|shuffled|parallel|domains\n"
+        << "  --threads N               Simulation threads\n"
+        << "  --steps S                 Steps for --headless, --processes and --ensemble runs (default 100)\n"
+        << "  --headless                Run S steps without the CLI and print throughput\n"
+        << "  --processes N [--transport shm|socket]  Split the run over N local processes; the CLI\n"
+        << "                            runs on rank 0 unless --headless\n"
+        << "  --ensemble N              Run seeds S..S+N-1 concurrently on --threads threads\n"
+        << "  --sweep P=v1,v2,...       Ensemble variants over P = trees|worms|birds; repeat to cross\n"
+        << "  --ensemble-csv PATH       Write per-step ensemble statistics as CSV\n"
+        << "  --trace PATH              Record a timeline and write it as trace-event JSON on exit;\n"
+        << "                            with --processes each rank writes PATH.rankN\n"
+        << "  --series PATH [--series-format bin|csv] [--series-every N]\n"
+        << "                            Write per-step statistics in the background (binary by default)\n"
+        << "  --restore PATH            Resume from a checkpoint instead of seeding a new grid\n"
+        << "  --checkpoint PATH [--checkpoint-every N]\n"
+        << "                            Save the model to PATH on exit, and after every N-th step\n";
+}
 
-int main() {
+int main(int argc, char** argv) {
     int height, width;
     height = 10;
     width = 10;
@@ -13,50 +102,256 @@ int main() {
     int n_worms = 1000;  // Number of initial worms
     int n_birds = 50;   // Number of initial birds
     uint16_t seed = 42; // Seed for RNG
-    Model model(height, width, true, seed);
+    bool torus = true;
+    Scheduler scheduler = Scheduler::Sequential;
+    unsigned threads = 1;
+    bool headless = false;
+    int ensembleSeeds = 0;
+    std::vector<std::string> sweeps;
+    std::string ensembleCsv;
+    std::string tracePath;
+    std::string seriesPath;
+    SeriesFormat seriesFormat = SeriesFormat::Binary;
+    unsigned seriesEvery = 1;
+    std::string restorePath;
+    std::string checkpointPath;
+    unsigned checkpointEvery = 0;
 
-    // Place trees randomly
-    std::uniform_int_distribution<int> dist_h(0, height - 1);
-    std::uniform_int_distribution<int> dist_w(0, width - 1);
-    
-    // Place trees
-    for (int i = 0; i < n_trees; ++i) {
-        int r = dist_h(model.getRNG());
-        int c = dist_w(model.getRNG());
-        Cell* cell = model.getCell(r, c);
-        if (cell) {
-            std::unique_ptr<Tree> tree = std::make_unique<Tree>(&model, model.getNextID(), cell);
-            model.queueAgentForAddition(std::move(tree));
+    // --processes N splits the run over N local processes
+    DistributedOptions distributed;
+    distributed.processes = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        try {
+            if (arg == "--headless") {
+                headless = true;
+            }
+            else if (arg == "--height" && hasValue) {
+                height = std::stoi(argv[++i]);
+            }
+            else if (arg == "--width" && hasValue) {
+                width = std::stoi(argv[++i]);
+            }
+            else if (arg == "--trees" && hasValue) {
+                n_trees = std::stoi(argv[++i]);
+            }
+            else if (arg == "--worms" && hasValue) {
+                n_worms = std::stoi(argv[++i]);
+            }
+            else if (arg == "--birds" && hasValue) {
+                n_birds = std::stoi(argv[++i]);
+            }
+            else if (arg == "--seed" && hasValue) {
+                int value = std::stoi(argv[++i]);
+                if (value < 0 || value > UINT16_MAX) {
+                    throw std::out_of_range("seed");
+                }
+                seed = static_cast<uint16_t>(value);
+            }
+            else if (arg == "--torus" && hasValue) {
+                torus = std::string(argv[++i]) != "off";
+            }
+            else if (arg == "--scheduler" && hasValue && parseScheduler(argv[i + 1], scheduler)) {
+                ++i;
+            }
+            else if (arg == "--threads" && hasValue) {
+                threads = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+            }
+            else if (arg == "--processes" && hasValue) {
+                distributed.processes = std::stoi(argv[++i]);
+            }
+            else if (arg == "--transport" && hasValue) {
+                std::string kind = argv[++i];
+                distributed.transport = kind == "socket" ? TransportKind::Socket : TransportKind::SharedMemory;
+            }
+            else if (arg == "--ensemble" && hasValue) {
+                ensembleSeeds = std::stoi(argv[++i]);
+            }
+            else if (arg == "--sweep" && hasValue) {
+                sweeps.push_back(argv[++i]);
+            }
+            else if (arg == "--series" && hasValue) {
+                seriesPath = argv[++i];
+            }
+            else if (arg == "--series-format" && hasValue) {
+                seriesFormat = std::string(argv[++i]) == "csv" ? SeriesFormat::Csv : SeriesFormat::Binary;
+            }
+            else if (arg == "--series-every" && hasValue) {
+                seriesEvery = static_cast<unsigned>(std::max(1, std::stoi(argv[++i])));
+            }
+            else if (arg == "--restore" && hasValue) {
+                restorePath = argv[++i];
+            }
+            else if (arg == "--checkpoint" && hasValue) {
+                checkpointPath = argv[++i];
+            }
+            else if (arg == "--checkpoint-every" && hasValue) {
+                checkpointEvery = static_cast<unsigned>(std::max(0, std::stoi(argv[++i])));
+            }
+            else if (arg == "--trace" && hasValue) {
+                tracePath = argv[++i];
+            }
+            else if (arg == "--ensemble-csv" && hasValue) {
+                ensembleCsv = argv[++i];
+            }
+            else if (arg == "--steps" && hasValue) {
+                distributed.steps = std::stoi(argv[++i]);
+            }
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
         }
+        catch (const std::exception&) {
+            std::cerr << "Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (height < 1 || width < 1) {
+        std::cerr << "Grid size must be positive" << std::endl;
+        return 1;
+    }
+    if (ensembleSeeds > 0 && seed + ensembleSeeds - 1 > UINT16_MAX) {
+        std::cerr << "Ensemble seeds run past 65535" << std::endl;
+        return 1;
+    }
+    if ((!restorePath.empty() || !checkpointPath.empty()) && (ensembleSeeds > 0 || distributed.processes > 0)) {
+        std::cerr << "Checkpoints cover single-process runs only" << std::endl;
+        return 1;
     }
+    if (checkpointEvery > 0 && checkpointPath.empty()) {
+        std::cerr << "--checkpoint-every needs --checkpoint PATH" << std::endl;
+        return 1;
+    }
+    if (!tracePath.empty()) {
+#if NHAGW_TRACE
+        Trace::enable(true);
+        Trace::setThreadName("main");
+#else
+        std::cerr << "Tracing is compiled out; rebuild with -DNHAGW_TRACE=1" << std::endl;
+        tracePath.clear();
+#endif
+    }
+    if (ensembleSeeds > 0) {
+        EnsembleSpec spec;
+        spec.height = height;
+        spec.width = width;
+        spec.torus = torus;
+        spec.scheduler = scheduler;
+        spec.steps = distributed.steps;
+        spec.threads = threads;
+        for (int i = 0; i < ensembleSeeds; ++i) {
+            spec.seeds.push_back(static_cast<uint16_t>(seed + i));
+        }
+        EnsembleVariant base;
+        base.trees = n_trees;
+        base.worms = n_worms;
+        base.birds = n_birds;
+        spec.variants.push_back(base);
+        for (const std::string& axis : sweeps) {
+            bool valid = false;
+            try {
+                valid = addSweep(spec.variants, axis);
+            } catch (const std::exception&) {
+            }
+            if (!valid) {
+                std::cerr << "Invalid sweep " << axis << std::endl;
+                return 1;
+            }
+        }
 
-    // Place worms randomly
-    for (int i = 0; i < n_worms; ++i) {
-        int r = dist_h(model.getRNG());
-        int c = dist_w(model.getRNG());
-        Cell* cell = model.getCell(r, c);
-        if (cell) {
-            std::unique_ptr<Worm> worm = std::make_unique<Worm>(&model, model.getNextID(), cell);
-            model.queueAgentForAddition(std::move(worm));
+        EnsembleResult result = runEnsemble(spec);
+        printEnsembleSummary(result);
+        if (!tracePath.empty()) {
+            writeTrace(tracePath);
         }
+        if (!ensembleCsv.empty()) {
+            std::ofstream out(ensembleCsv);
+            if (!out) {
+                std::cerr << "Cannot write " << ensembleCsv << std::endl;
+                return 1;
+            }
+            writeEnsembleCsv(result, out);
+        }
+        return 0;
+    }
+    if (distributed.processes > 0) {
+        distributed.interactive = !headless;
+        distributed.tracePath = tracePath;
+        return runDistributed(distributed, [&] {
+            auto model = std::make_unique<Model>(height, width, torus, seed);
+            model->setScheduler(scheduler);
+            model->setThreadCount(threads);
+            populate(*model, n_trees, n_worms, n_birds);
+            return model;
+        });
     }
 
-    // Place birds randomly
-    for (int i = 0; i < n_birds; ++i) {
-        int r = dist_h(model.getRNG());
-        int c = dist_w(model.getRNG());
-        Cell* cell = model.getCell(r, c);
-        if (cell) {
-            std::unique_ptr<Bird> bird = std::make_unique<Bird>(&model, model.getNextID(), cell);
-            model.queueAgentForAddition(std::move(bird));
+    // A restored model keeps its saved grid, seed and population; the other options still apply
+    std::unique_ptr<Model> restored;
+    if (!restorePath.empty()) {
+        try {
+            restored = Checkpoint::load(restorePath);
         }
+        catch (const std::exception& e) {
+            std::cerr << "Restore: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Restored " << restorePath << " at step " << restored->getStepCount() << std::endl;
+    }
+    else {
+        restored = std::make_unique<Model>(height, width, torus, seed);
+        populate(*restored, n_trees, n_worms, n_birds);
+    }
+    Model& model = *restored;
+    model.setScheduler(scheduler);
+    model.setThreadCount(threads);
+    if (checkpointEvery > 0) {
+        model.setCheckpointSchedule(checkpointEvery, checkpointPath);
     }
 
-    // Process all queued agents
-    model.processAgentQueues();
+    std::unique_ptr<TimeSeriesWriter> series;
+    if (!seriesPath.empty()) {
+        try {
+            series = std::make_unique<TimeSeriesWriter>(model, seriesPath, seriesFormat, seriesEvery);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Time series: " << e.what() << std::endl;
+            return 1;
+        }
+        model.setTimeSeries(series.get());
+    }
 
-    // Main loop
-    model.initializeSimulation();
+    if (headless) {
+        runHeadless(model, distributed.steps);
+    }
+    else {
+        // Main loop
+        model.initializeSimulation();
+    }
+    if (series) {
+        model.setTimeSeries(nullptr);
+        unsigned long long dropped = series->getDropped();
+        series.reset();
+        std::cout << "Time series written to " << seriesPath;
+        if (dropped > 0) {
+            std::cout << " (" << dropped << " steps dropped while the writer fell behind)";
+        }
+        std::cout << std::endl;
+    }
+    if (!checkpointPath.empty()) {
+        try {
+            Checkpoint::save(model, checkpointPath);
+            std::cout << "Checkpoint at step " << model.getStepCount() << " written to " << checkpointPath << std::endl;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Checkpoint: " << e.what() << std::endl;
+        }
+    }
+    if (!tracePath.empty()) {
+        writeTrace(tracePath);
+    }
 
     return 0;
-}
\ No newline at end of file
+}